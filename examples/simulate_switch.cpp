@@ -0,0 +1,96 @@
+#include <iostream>
+#include <cstdlib>
+#include "SimpleFSM.hpp"
+#include "FSMBuilder.hpp"
+#include "Concurrency/SimulatedConcurrencyPlatform.hpp"
+#include "Simulation/EventGenerator.hpp"
+#include "Simulation/SimulationDriver.hpp"
+
+enum class States {
+  ON,
+  OFF,
+  _SIMPLE_FSM_INVALID_,
+};
+
+char const *stateNames[(size_t)States::_SIMPLE_FSM_INVALID_] = {
+  "ON",
+  "OFF",
+};
+
+enum class Events {
+  TOGGLE,
+  NOISE,
+};
+
+using namespace SimpleFSM;
+// The driver counts transitions & state visits through the transition hooks
+using SwitchFSM = FSMBuilder<States, Events>::with<Hooks, ThreadSafe<SimulatedConcurrencyPlatform, 8>>;
+
+// Turns itself off after 500ms
+class OnState : public SwitchFSM::State {
+public:
+  OnState(SwitchFSM &fsm): SwitchFSM::State(States::ON, eventMask<Events::TOGGLE>()), _fsm(fsm) {}
+  virtual void entry() {
+    _since = _fsm.getConcurrencyPlatform().getTimeMs();
+  }
+  virtual void react(Events ev, SwitchFSM::EventPayload const &) {
+    switch (ev) {
+      case Events::TOGGLE: _fsm.transit(States::OFF); break;
+      default: break;
+    }
+  }
+  virtual void exit() {}
+  virtual void loop() {
+    if (_fsm.getConcurrencyPlatform().getTimeMs() - _since > 500) _fsm.transit(States::OFF);
+  }
+
+private:
+  SwitchFSM &_fsm;
+  uint32_t  _since = 0;
+};
+
+class OffState : public SwitchFSM::State {
+public:
+  OffState(SwitchFSM &fsm): SwitchFSM::State(States::OFF, eventMask<Events::TOGGLE>()), _fsm(fsm) {}
+  virtual void entry() {}
+  virtual void react(Events ev, SwitchFSM::EventPayload const &) {
+    switch (ev) {
+      case Events::TOGGLE: _fsm.transit(States::ON); break;
+      default: break;
+    }
+  }
+  virtual void exit() {}
+  virtual void loop() {}
+
+private:
+  SwitchFSM &_fsm;
+};
+
+int main(int argc, char **argv) {
+  using Driver = SimulationDriver<SwitchFSM, States, Events>;
+
+  Driver::Config config;
+  config.machines = argc > 1 ? atoi(argv[1]) : 1000;
+  config.events = argc > 2 ? atoll(argv[2]) : 1000000;
+  config.eventsPerUpdate = 4;
+  config.msPerEvent = 1;
+
+  Driver driver(config, [](SwitchFSM &fsm, size_t) {
+    fsm.emplaceState<OnState>(fsm);
+    fsm.emplaceState<OffState>(fsm);
+    fsm.start(States::OFF);
+  });
+
+  EventGenerator<Events> generator(42);
+  generator.setWeight(Events::TOGGLE, 1);
+  generator.setWeight(Events::NOISE, 9);
+
+  auto report = driver.run(generator);
+  std::cout << config.machines << " machines, " << report.events << " events, " << report.updates << " updates, "
+            << report.errors << " errors, in " << report.seconds << "s" << std::endl;
+  std::cout << report.eventsPerSecond() << " events/s, "
+            << report.transitions << " transitions (" << report.transitionsPerSecond() << "/s)" << std::endl;
+  for (size_t i = 0; i < (size_t)States::_SIMPLE_FSM_INVALID_; ++i) {
+    std::cout << "Visits of state " << stateNames[i] << ": " << report.stateVisits[i] << std::endl;
+  }
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include "SimpleFSM.hpp"
+#include "LambdaState.hpp"
+#include "ThreadSafeFSM.hpp"
+#include "FSMExecutor.hpp"
+#include "Concurrency/StdConcurrencyPlatform.hpp"
+
+enum class States {
+  ON,
+  OFF,
+  _SIMPLE_FSM_INVALID_,
+};
+
+char const *stateNames[(size_t)States::_SIMPLE_FSM_INVALID_ + 1] = {
+  "ON",
+  "OFF",
+  "INVALID"
+};
+
+enum class Events {
+  TOGGLE
+};
+
+using namespace SimpleFSM;
+// Actor FSMs are never locked: other threads can only post events into their mailbox (of 8 events)
+using SwitchFSM = ThreadSafeFSM<FSM<States, Events>, States, Events, EmptyPayload,
+                                StdConcurrencyPlatform, 8, ThreadSafetyMode::ACTOR>;
+using SwitchState = LambdaState<States, Events>;
+
+void setup(SwitchFSM &fsm) {
+  fsm.emplaceState<SwitchState>(States::ON, SwitchState::Config{
+    .react = [&fsm](Events ev, SwitchFSM::EventPayload) {
+      switch (ev) {
+        case Events::TOGGLE: fsm.transit(States::OFF); break;
+      }
+    }
+  });
+
+  fsm.emplaceState<SwitchState>(States::OFF, SwitchState::Config{
+    .react = [&fsm](Events ev, SwitchFSM::EventPayload) {
+      switch (ev) {
+        case Events::TOGGLE: fsm.transit(States::ON); break;
+      }
+    }
+  });
+}
+
+int main() {
+  constexpr unsigned int MACHINES = 3;
+  SwitchFSM switches[MACHINES];
+  FSMExecutor executor;
+  for (auto &fsm : switches) {
+    setup(fsm);
+    executor.add(fsm);
+  }
+
+  // The executor thread owns the FSMs: it is the only one starting and updating them
+  std::atomic<bool> started{false};
+  std::atomic<bool> running{true};
+  std::thread executorThread([&]() {
+    for (auto &fsm : switches) fsm.start(States::OFF);
+    started = true;
+    while (running) {
+      executor.runOnce();
+      std::this_thread::yield();
+    }
+    executor.runOnce();  // Dispatches what is left in the mailboxes
+  });
+
+  // The switch i is toggled 100 + i times, from another thread
+  std::thread posterThread([&]() {
+    while (!started) std::this_thread::yield();
+    for (unsigned int i = 0; i < MACHINES; ++i) {
+      for (unsigned int toggles = 0; toggles < 100 + i; ) {
+        // The mailbox may be full: wait for the executor to catch up
+        if (switches[i].emit(Events::TOGGLE) == FSMError::OK) ++toggles;
+      }
+    }
+  });
+
+  posterThread.join();
+  running = false;
+  executorThread.join();
+
+  for (unsigned int i = 0; i < MACHINES; ++i) {
+    auto snapshot = switches[i].getStateSnapshot();
+    std::cout << "Switch " << i << ": " << stateNames[(size_t)snapshot.state]
+              << " after " << snapshot.transitions << " transitions" << std::endl;
+  }
+}
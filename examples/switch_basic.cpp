@@ -18,7 +18,7 @@ using SwitchFSM = FSM<States, Events, PAYLOAD>;
 
 class OnState : public SwitchFSM::State {
 public:
-  OnState(SwitchFSM &fsm): SwitchFSM::State(States::ON), _fsm(fsm) {}
+  OnState(SwitchFSM &fsm): SwitchFSM::State(States::ON, eventMask<Events::TOGGLE>()), _fsm(fsm) {}
   virtual void entry() {
     std::cout << "Entering state ON" << std::endl;
   }
@@ -36,7 +36,7 @@ private:
 
 class OffState : public SwitchFSM::State {
 public:
-  OffState(SwitchFSM &fsm): SwitchFSM::State(States::OFF), _fsm(fsm) {}
+  OffState(SwitchFSM &fsm): SwitchFSM::State(States::OFF, eventMask<Events::TOGGLE>()), _fsm(fsm) {}
   virtual void entry() {
     std::cout << "Entering state OFF" << std::endl;
   }
@@ -54,8 +54,8 @@ private:
 
 int main() {
   SwitchFSM fsm;
-  fsm.addState(new OnState(fsm));
-  fsm.addState(new OffState(fsm));
+  fsm.emplaceState<OnState>(fsm);
+  fsm.emplaceState<OffState>(fsm);
 
   fsm.start(States::ON);
   fsm.emit(Events::TOGGLE, PAYLOAD());
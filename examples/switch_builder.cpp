@@ -0,0 +1,76 @@
+#include <iostream>
+#include "SimpleFSM.hpp"
+#include "LambdaState.hpp"
+#include "FSMBuilder.hpp"
+#include "Concurrency/SimulatedConcurrencyPlatform.hpp"
+
+enum class States {
+  ON,
+  OFF,
+  BROKEN,
+  _SIMPLE_FSM_INVALID_,
+};
+
+char const *stateNames[(size_t)States::_SIMPLE_FSM_INVALID_ + 1] = {
+  "ON",
+  "OFF",
+  "BROKEN",
+  "INVALID"
+};
+
+enum class Events {
+  TOGGLE
+};
+
+using namespace SimpleFSM;
+int main() {
+  // Events are queued, and dispatched on update(), with their hooks
+  using FSM = FSMBuilder<States, Events>::with<Hooks, Permissions, ThreadSafe<SimulatedConcurrencyPlatform, 4>>;
+  using LambdaState = LambdaState<States, Events>;
+  FSM fsm;
+
+  fsm.emplaceState<LambdaState>(States::ON, LambdaState::Config{
+    .react = [&fsm](Events ev, FSM::EventPayload) {
+      switch (ev) {
+        case Events::TOGGLE: fsm.transit(States::OFF); break;
+      }
+    }
+  });
+
+  fsm.emplaceState<LambdaState>(States::OFF, LambdaState::Config{
+    .react = [&fsm](Events ev, FSM::EventPayload) {
+      switch (ev) {
+        case Events::TOGGLE: fsm.transit(States::ON); break;
+      }
+    }
+  });
+
+  // BROKEN handles no event at all
+  fsm.emplaceState<LambdaState>(States::BROKEN, LambdaState::Config{}, EventMask(0));
+
+  // The switch breaks after 3 transitions
+  unsigned int transitions = 0;
+  fsm.addRule([&transitions](States state) {
+    return (transitions >= 3) ? States::BROKEN : state;
+  });
+
+  fsm.onPermissionRejection([](States to) {
+    std::cout << "Permission rejected for state " << stateNames[(size_t)to] << std::endl;
+  });
+
+  fsm.onTransition([&transitions](States from, States to) {
+    ++transitions;
+    std::cout << "Transitioned from state " << stateNames[(size_t)from] << " to state " << stateNames[(size_t)to] << std::endl;
+  });
+
+  fsm.onEvent([](Events, FSM::EventPayload const &) {
+    std::cout << "Received event TOGGLE" << std::endl;
+  });
+
+  fsm.start(States::OFF);
+  for (int i = 0; i < 5; ++i) {
+    fsm.emit(Events::TOGGLE);
+    fsm.update();
+    std::cout << "State: " << stateNames[(size_t)fsm.getCurrentState()] << std::endl;
+  }
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include "SimpleFSM.hpp"
+#include "CoroutineState.hpp"
+
+enum class States {
+  ON,
+  OFF,
+  _SIMPLE_FSM_INVALID_,
+};
+
+enum class Events {
+  TOGGLE,
+  PRESS,
+};
+
+using namespace SimpleFSM;
+using SwitchFSM = FSM<States, Events>;
+using SwitchState = CoroutineState<States, Events>;
+
+// Turns off after the button was pressed twice, then held for 3 updates
+class OnState : public SwitchState {
+public:
+  OnState(SwitchFSM &fsm): SwitchState(States::ON, eventMask<Events::PRESS>()), _fsm(fsm) {}
+
+  Task run() override {
+    std::cout << "Entering state ON" << std::endl;
+    co_await awaitEvent(Events::PRESS);
+    std::cout << "Pressed once" << std::endl;
+    co_await awaitEvent(Events::PRESS);
+    std::cout << "Pressed twice" << std::endl;
+    co_await awaitUpdates(3);
+    std::cout << "Held for 3 updates" << std::endl;
+    _fsm.transit(States::OFF);
+  }
+
+private:
+  SwitchFSM &_fsm;
+};
+
+class OffState : public SwitchState {
+public:
+  OffState(SwitchFSM &fsm): SwitchState(States::OFF), _fsm(fsm) {}
+
+  Task run() override {
+    std::cout << "Entering state OFF" << std::endl;
+    int updates = 0;
+    co_await awaitCondition([&updates]() { return ++updates == 2; });
+    std::cout << "Condition met, now waiting for any event" << std::endl;
+    co_await awaitAnyEvent();
+    _fsm.transit(States::ON);
+  }
+
+private:
+  SwitchFSM &_fsm;
+};
+
+int main() {
+  SwitchFSM fsm;
+  fsm.emplaceState<OnState>(fsm);
+  fsm.emplaceState<OffState>(fsm);
+
+  fsm.start(States::ON);
+  fsm.emit(Events::TOGGLE); // Not handled by ON: skipped
+  fsm.emit(Events::PRESS);
+  fsm.emit(Events::PRESS);
+  for (int i = 0; i < 5; ++i) {
+    std::cout << "Updating" << std::endl;
+    fsm.update();
+  }
+  fsm.emit(Events::TOGGLE);
+}
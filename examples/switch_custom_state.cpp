@@ -56,8 +56,8 @@ private:
 
 int main() {
   SwitchFSM fsm;
-  fsm.addState(new OnState(fsm));
-  fsm.addState(new OffState(fsm));
+  fsm.emplaceState<OnState>(fsm);
+  fsm.emplaceState<OffState>(fsm);
 
   fsm.start(States::ON);
   fsm.update();
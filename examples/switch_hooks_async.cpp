@@ -0,0 +1,84 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include "SimpleFSM.hpp"
+#include "HookableFSM.hpp"
+#include "LambdaState.hpp"
+
+enum class States {
+  ON,
+  OFF,
+  _SIMPLE_FSM_INVALID_,
+};
+
+char const *stateNames[(size_t)States::_SIMPLE_FSM_INVALID_ + 1] = {
+  "ON",
+  "OFF",
+  "INVALID"
+};
+
+enum class Events {
+  TOGGLE,
+  NOISE,
+};
+
+char const *eventNames[2] = {
+  "TOGGLE",
+  "NOISE",
+};
+
+using namespace SimpleFSM;
+int main() {
+  // Hooks are called by another thread, from a buffer of 64 records
+  using FSM = HookableFSM<FSM<States, Events>, States, Events, EmptyPayload, 64>;
+  using LambdaState = LambdaState<States, Events>;
+  FSM fsm;
+
+  fsm.addState(new LambdaState(States::ON, {
+    .entry = LambdaState::EntryFunction(),
+    .react = [&fsm](Events ev, FSM::EventPayload) {
+      switch (ev) {
+        case Events::TOGGLE: fsm.transit(States::OFF); break;
+        default: break;
+      }
+    }
+  }), eventMask<Events::TOGGLE>());
+
+  fsm.addState(new LambdaState(States::OFF, {
+    .entry = LambdaState::EntryFunction(),
+    .react = [&fsm](Events ev, FSM::EventPayload) {
+      switch (ev) {
+        case Events::TOGGLE: fsm.transit(States::ON); break;
+        default: break;
+      }
+    }
+  }), eventMask<Events::TOGGLE>());
+
+  fsm.onTransition([](States from, States to) {
+    std::cout << "Transitioned from state " << stateNames[(size_t)from] << " to state " << stateNames[(size_t)to] << std::endl;
+  });
+
+  // A batched hook is called once for a run of identical records, with its length
+  fsm.onEvent([](Events event, FSM::EventPayload const &, unsigned int count) {
+    std::cout << "Received event " << eventNames[(size_t)event] << " x" << count << std::endl;
+  });
+
+  std::atomic<bool> running{true};
+  std::thread hooksThread([&fsm, &running]() {
+    while (running) {
+      fsm.dispatchHooks();
+      std::this_thread::yield();
+    }
+    fsm.dispatchHooks();
+  });
+
+  fsm.start(States::ON);
+  fsm.emit(Events::TOGGLE);
+  // Consecutive identical records may be coalesced into a single batched hook call
+  for (int i = 0; i < 5; ++i) fsm.emit(Events::NOISE);
+  fsm.emit(Events::TOGGLE);
+
+  running = false;
+  hooksThread.join();
+  std::cout << "Dropped records: " << fsm.getDroppedHookRecords() << std::endl;
+}
@@ -2,6 +2,7 @@
 #include <freertos/FreeRTOS.h>
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #include "./IConcurrencyPlatform.hpp"
 
@@ -9,6 +10,7 @@ namespace SimpleFSM {
   struct FreeRTOSConcurrencyPlatform : public IConcurrencyPlatform {
     struct Queue : public IConcurrencyPlatform::Queue {
       Queue(unsigned int elements, unsigned int elementSize);
+      ~Queue();
       bool push(void *element, uint32_t timeout);
       bool pop(void *element, uint32_t timeout);
      private:
@@ -18,12 +20,15 @@ namespace SimpleFSM {
 
     struct Mutex : public IConcurrencyPlatform::Mutex {
       Mutex();
+      ~Mutex();
       bool take(uint32_t timeout);
       bool give();
      private:
       SemaphoreHandle_t _mutex;
     };
     virtual IConcurrencyPlatform::Mutex *makeMutex();
+
+    virtual uint32_t getTimeMs();
   };
   
   /* Implementation */
@@ -33,6 +38,10 @@ namespace SimpleFSM {
     _queue = xQueueCreate(elements, elementSize);
   }
 
+  inline FreeRTOSConcurrencyPlatform::Queue::~Queue() {
+    vQueueDelete(_queue);
+  }
+
   inline bool FreeRTOSConcurrencyPlatform::Queue::push(void *element, uint32_t timeoutMs) {
     return xQueueSendToBack(_queue, element, timeoutMs / portTICK_PERIOD_MS) == pdTRUE;
   }
@@ -51,6 +60,10 @@ namespace SimpleFSM {
     _mutex = xSemaphoreCreateRecursiveMutex();
   }
 
+  inline FreeRTOSConcurrencyPlatform::Mutex::~Mutex() {
+    vSemaphoreDelete(_mutex);
+  }
+
   inline bool FreeRTOSConcurrencyPlatform::Mutex::take(uint32_t timeoutMs) {
     return xSemaphoreTakeRecursive(_mutex, timeoutMs / portTICK_PERIOD_MS) == pdTRUE;
   }
@@ -64,4 +77,9 @@ namespace SimpleFSM {
     return new FreeRTOSConcurrencyPlatform::Mutex();
   }
 
+  /* Time */
+  inline uint32_t FreeRTOSConcurrencyPlatform::getTimeMs() {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+  }
+
 };
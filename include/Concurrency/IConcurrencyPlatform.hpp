@@ -1,18 +1,26 @@
 #pragma once
-#include <ctype.h>
+#include <stdint.h>
 
 namespace SimpleFSM {
   struct IConcurrencyPlatform {
     struct Queue {
-      virtual bool push(void *element, uint32_t timeoutMs);
-      virtual bool pop(void *element, uint32_t timeoutMs);
+      virtual ~Queue() {}
+      virtual bool push(void *element, uint32_t timeoutMs) = 0;
+      virtual bool pop(void *element, uint32_t timeoutMs) = 0;
     };
     virtual Queue *makeQueue(uint32_t elements, uint32_t elementSize) = 0;
 
     struct Mutex {
-      virtual bool take(uint32_t timeoutMs);
-      virtual bool give();
+      virtual ~Mutex() {}
+      virtual bool take(uint32_t timeoutMs) = 0;
+      virtual bool give() = 0;
     };
     virtual Mutex *makeMutex() = 0;
+
+    /**
+     * @brief Returns the platform time, in milliseconds. States should use it rather than any other clock,
+     * so that their timing can be simulated (see SimulatedConcurrencyPlatform)
+     */
+    virtual uint32_t getTimeMs() = 0;
   };
 };
@@ -4,10 +4,12 @@
 namespace SimpleFSM {
   /**
    * @brief A RAII-based tool to safely lock/unlock mutexes
+   * A null mutex is accepted, and never locked
    */
   class LockContext {
   public:
-    LockContext(IConcurrencyPlatform::Mutex *mutex): _mutex(mutex) {
+    LockContext(IConcurrencyPlatform::Mutex *mutex): _locking(mutex != nullptr), _mutex(mutex) {
+      if (!_locking) return;
       while (!_mutex->take(1)) {}  // Requires OS frequency >= 1kHz
     }
     // Can be called to unlock before destruction
@@ -21,7 +23,7 @@ namespace SimpleFSM {
       unlock();
     }
    private:
-    bool _locking = true;
+    bool _locking;
     IConcurrencyPlatform::Mutex *_mutex;
   };
 };
@@ -0,0 +1,111 @@
+#pragma once
+#include <string.h>
+#include <vector>
+
+#include "./IConcurrencyPlatform.hpp"
+
+namespace SimpleFSM {
+  /**
+   * @brief A deterministic, single-threaded platform, used to run FSMs on a host (simulations, load tests, ...)
+   * Time is virtual: it only moves when advanced explicitly, or when a queue operation times out.
+   * All instances share the same clock.
+   */
+  struct SimulatedConcurrencyPlatform : public IConcurrencyPlatform {
+    /**
+     * @brief The virtual clock shared by all simulated platforms
+     */
+    struct Clock {
+      uint32_t getTimeMs() const { return _timeMs; }
+      void     setTimeMs(uint32_t timeMs) { _timeMs = timeMs; }
+      void     advance(uint32_t ms) { _timeMs += ms; }
+     private:
+      uint32_t _timeMs = 0;
+    };
+    static Clock &clock();
+
+    struct Queue : public IConcurrencyPlatform::Queue {
+      Queue(unsigned int elements, unsigned int elementSize);
+      bool push(void *element, uint32_t timeoutMs);
+      bool pop(void *element, uint32_t timeoutMs);
+     private:
+      std::vector<unsigned char> _buffer;
+      unsigned int               _elements;
+      unsigned int               _elementSize;
+      unsigned int               _head = 0;
+      unsigned int               _count = 0;
+    };
+    virtual IConcurrencyPlatform::Queue *makeQueue(unsigned int elements, unsigned int elementSize);
+
+    struct Mutex : public IConcurrencyPlatform::Mutex {
+      bool take(uint32_t timeout);
+      bool give();
+     private:
+      unsigned int _depth = 0;
+    };
+    virtual IConcurrencyPlatform::Mutex *makeMutex();
+
+    virtual uint32_t getTimeMs();
+  };
+
+  /* Implementation */
+
+  /* Clock */
+  inline SimulatedConcurrencyPlatform::Clock &SimulatedConcurrencyPlatform::clock() {
+    static Clock instance;
+    return instance;
+  }
+
+  inline uint32_t SimulatedConcurrencyPlatform::getTimeMs() {
+    return clock().getTimeMs();
+  }
+
+  /* Queue */
+  // Nothing else can run while waiting, so a full / empty queue stays so: the timeout elapses immediately
+  inline SimulatedConcurrencyPlatform::Queue::Queue(unsigned int elements, unsigned int elementSize)
+  : _buffer(elements * elementSize), _elements(elements), _elementSize(elementSize) {}
+
+  inline bool SimulatedConcurrencyPlatform::Queue::push(void *element, uint32_t timeoutMs) {
+    if (_count == _elements) {
+      clock().advance(timeoutMs);
+      return false;
+    }
+    unsigned int tail = (_head + _count) % _elements;
+    memcpy(&_buffer[tail * _elementSize], element, _elementSize);
+    ++_count;
+    return true;
+  }
+
+  inline bool SimulatedConcurrencyPlatform::Queue::pop(void *element, uint32_t timeoutMs) {
+    if (_count == 0) {
+      clock().advance(timeoutMs);
+      return false;
+    }
+    memcpy(element, &_buffer[_head * _elementSize], _elementSize);
+    _head = (_head + 1) % _elements;
+    --_count;
+    return true;
+  }
+
+  inline IConcurrencyPlatform::Queue *
+  SimulatedConcurrencyPlatform::makeQueue(unsigned int elements, unsigned int elementSize) {
+    return new SimulatedConcurrencyPlatform::Queue(elements, elementSize);
+  }
+
+  /* Mutex */
+  // Recursive, and never contended as everything runs on a single thread
+  inline bool SimulatedConcurrencyPlatform::Mutex::take(uint32_t) {
+    ++_depth;
+    return true;
+  }
+
+  inline bool SimulatedConcurrencyPlatform::Mutex::give() {
+    if (_depth == 0) return false;
+    --_depth;
+    return true;
+  }
+
+  inline IConcurrencyPlatform::Mutex *
+  SimulatedConcurrencyPlatform::makeMutex() {
+    return new SimulatedConcurrencyPlatform::Mutex();
+  }
+};
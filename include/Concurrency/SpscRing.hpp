@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+
+namespace SimpleFSM {
+  /**
+   * @brief A fixed-size, lock-free ring buffer, for exactly one producer thread and one consumer thread
+   * @tparam T The element type
+   * @tparam SIZE The maximum number of elements stored at once
+   */
+  template <class T, unsigned int SIZE>
+  class SpscRing {
+    static_assert(SIZE > 0, "SpscRing needs a size greater than 0");
+
+  public:
+    /**
+     * @brief Appends an element. Must only be called by the producer
+     * @return false if the ring is full
+     */
+    bool push(T const &element) {
+      unsigned int tail = _tail.load(std::memory_order_relaxed);
+      unsigned int next = _next(tail);
+      if (next == _head.load(std::memory_order_acquire)) return false;
+      _elements[tail] = element;
+      _tail.store(next, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * @brief Removes the oldest element. Must only be called by the consumer
+     * @return false if the ring is empty
+     */
+    bool pop(T &element) {
+      unsigned int head = _head.load(std::memory_order_relaxed);
+      if (head == _tail.load(std::memory_order_acquire)) return false;
+      element = _elements[head];
+      _head.store(_next(head), std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * @brief Returns the oldest element without removing it, or nullptr if the ring is empty.
+     * Must only be called by the consumer
+     */
+    T const *peek() const {
+      unsigned int head = _head.load(std::memory_order_relaxed);
+      if (head == _tail.load(std::memory_order_acquire)) return nullptr;
+      return &_elements[head];
+    }
+
+  private:
+    // One slot is always left empty, to tell a full ring from an empty one
+    static unsigned int _next(unsigned int index) { return (index + 1) % (SIZE + 1); }
+
+    T                         _elements[SIZE + 1];
+    std::atomic<unsigned int> _head{0};
+    std::atomic<unsigned int> _tail{0};
+  };
+};
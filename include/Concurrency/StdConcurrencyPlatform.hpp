@@ -0,0 +1,115 @@
+#pragma once
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "./IConcurrencyPlatform.hpp"
+
+namespace SimpleFSM {
+  /**
+   * @brief A platform based on the C++ standard library (std::mutex, std::condition_variable, std::chrono),
+   * used to run thread-safe FSMs on a host, with real threads
+   */
+  struct StdConcurrencyPlatform : public IConcurrencyPlatform {
+    struct Queue : public IConcurrencyPlatform::Queue {
+      Queue(unsigned int elements, unsigned int elementSize);
+      bool push(void *element, uint32_t timeoutMs);
+      bool pop(void *element, uint32_t timeoutMs);
+     private:
+      std::mutex                 _mutex;
+      std::condition_variable    _notFull;
+      std::condition_variable    _notEmpty;
+      std::vector<unsigned char> _buffer;
+      unsigned int               _elements;
+      unsigned int               _elementSize;
+      unsigned int               _head = 0;
+      unsigned int               _count = 0;
+    };
+    virtual IConcurrencyPlatform::Queue *makeQueue(unsigned int elements, unsigned int elementSize);
+
+    struct Mutex : public IConcurrencyPlatform::Mutex {
+      bool take(uint32_t timeoutMs);
+      bool give();
+     private:
+      std::mutex              _mutex;
+      std::condition_variable _released;
+      std::thread::id         _owner;
+      unsigned int            _depth = 0;
+    };
+    virtual IConcurrencyPlatform::Mutex *makeMutex();
+
+    virtual uint32_t getTimeMs();
+  };
+
+  /* Implementation */
+
+  /* Queue */
+  inline StdConcurrencyPlatform::Queue::Queue(unsigned int elements, unsigned int elementSize)
+  : _buffer(elements * elementSize), _elements(elements), _elementSize(elementSize) {}
+
+  inline bool StdConcurrencyPlatform::Queue::push(void *element, uint32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_notFull.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return _count < _elements; }))
+      return false;
+    unsigned int tail = (_head + _count) % _elements;
+    memcpy(&_buffer[tail * _elementSize], element, _elementSize);
+    ++_count;
+    lock.unlock();
+    _notEmpty.notify_one();
+    return true;
+  }
+
+  inline bool StdConcurrencyPlatform::Queue::pop(void *element, uint32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_notEmpty.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return _count > 0; }))
+      return false;
+    memcpy(element, &_buffer[_head * _elementSize], _elementSize);
+    _head = (_head + 1) % _elements;
+    --_count;
+    lock.unlock();
+    _notFull.notify_one();
+    return true;
+  }
+
+  inline IConcurrencyPlatform::Queue *
+  StdConcurrencyPlatform::makeQueue(unsigned int elements, unsigned int elementSize) {
+    return new StdConcurrencyPlatform::Queue(elements, elementSize);
+  }
+
+  /* Mutex */
+  // Recursive, like the FreeRTOS one
+  inline bool StdConcurrencyPlatform::Mutex::take(uint32_t timeoutMs) {
+    std::thread::id self = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_released.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, self] { return _depth == 0 || _owner == self; }))
+      return false;
+    _owner = self;
+    ++_depth;
+    return true;
+  }
+
+  inline bool StdConcurrencyPlatform::Mutex::give() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_depth == 0 || _owner != std::this_thread::get_id()) return false;
+    if (--_depth == 0) {
+      _owner = std::thread::id();
+      lock.unlock();
+      _released.notify_one();
+    }
+    return true;
+  }
+
+  inline IConcurrencyPlatform::Mutex *
+  StdConcurrencyPlatform::makeMutex() {
+    return new StdConcurrencyPlatform::Mutex();
+  }
+
+  /* Time */
+  inline uint32_t StdConcurrencyPlatform::getTimeMs() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+  }
+};
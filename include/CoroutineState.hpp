@@ -0,0 +1,271 @@
+#pragma once
+#include <SimpleFSM.hpp>
+
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+# error "CoroutineState.hpp needs C++20 coroutines (e.g. -std=c++20)"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+#ifndef SIMPLE_FSM_COROUTINE_FRAME_SIZE // Defines how many bytes each CoroutineState reserves for its coroutine frame
+# define SIMPLE_FSM_COROUTINE_FRAME_SIZE 256
+#endif
+
+namespace SimpleFSM {
+  /**
+   * @brief An implementation of the class State whose behaviour is written as a single C++20 coroutine.
+   * This allows to write sequences (wait for an event, then wait N updates, ...) without splitting them into sub-states.
+   *
+   * The coroutine (run()) is started on entry() and destroyed on exit().
+   * While it is suspended, it costs nothing: events that are not awaited are dropped with a single comparison,
+   * and loop() only decrements a counter or evaluates the awaited condition.
+   *
+   * The coroutine frame is stored inside the state itself (FRAME_SIZE bytes), so no heap allocation ever happens.
+   * If the frame does not fit, std::terminate() is called when entering the state, as a state whose body never runs
+   * would silently block the FSM: increase FRAME_SIZE (or SIMPLE_FSM_COROUTINE_FRAME_SIZE) in that case.
+   *
+   * Note: Code placed after a transit() inside run() still executes until the next co_await / co_return,
+   * exactly like code placed after a transit() inside react().
+   */
+  template <class StateEnum, class EventEnum, class EventPayload=EmptyPayload,
+            typename Base = typename FSM<StateEnum, EventEnum, EventPayload>::State,
+            size_t FRAME_SIZE = SIMPLE_FSM_COROUTINE_FRAME_SIZE>
+  class CoroutineState : public Base {
+  private:
+    using BaseState = Base;
+
+  public:
+    /**
+     * @brief The return type of run(). Can only be used by member functions of a CoroutineState
+     */
+    class Task {
+    public:
+      struct promise_type {
+        // The frame is taken from the state owning the coroutine (passed as the implicit object parameter of run())
+        static void *operator new(size_t size, CoroutineState &self) noexcept {
+          return self._allocateFrame(size);
+        }
+        // The frame is released by the state itself, when destroying the coroutine
+        static void operator delete(void *) noexcept {}
+
+        static Task get_return_object_on_allocation_failure() { return Task(); }
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+      };
+
+      Task() = default;
+      Task(Task &&other): _handle(other._handle) { other._handle = nullptr; }
+      Task &operator=(Task &&other) {
+        std::swap(_handle, other._handle);
+        return *this;
+      }
+      Task(Task const &) = delete;
+      Task &operator=(Task const &) = delete;
+
+      explicit operator bool() const { return static_cast<bool>(_handle); }
+
+    private:
+      friend class CoroutineState;
+      explicit Task(std::coroutine_handle<promise_type> handle): _handle(handle) {}
+
+      std::coroutine_handle<promise_type> _handle = nullptr;
+    };
+
+    CoroutineState(StateEnum state): BaseState(state) {}
+    /**
+     * @param handledEvents The events for which react() is called (see eventMask()). Other events never reach the coroutine
+     */
+    CoroutineState(StateEnum state, EventMask handledEvents): BaseState(state, handledEvents) {}
+    virtual ~CoroutineState() { _destroyCoroutine(); }
+
+    /**
+     * @brief The body of the state. Started on entry(), destroyed on exit()
+     */
+    virtual Task run() = 0;
+
+    virtual void entry() {
+      if (_resuming) {
+        // Re-entered from inside the coroutine: restart it once it is suspended
+        _restartPending = true;
+        return;
+      }
+      _startCoroutine();
+    }
+
+    virtual void loop() {
+      switch (_wait) {
+        case Wait::UPDATES:
+          if (--_updatesLeft == 0) _resumeCoroutine();
+          break;
+        case Wait::CONDITION:
+          if (_condition(_conditionContext)) _resumeCoroutine();
+          break;
+        default:
+          break;
+      }
+    }
+
+    virtual void exit() {
+      if (_resuming) {
+        // Exited from inside the coroutine: it cannot be destroyed while it is running
+        _exitPending = true;
+        _restartPending = false;
+        return;
+      }
+      _destroyCoroutine();
+    }
+
+    virtual void react(EventEnum event, EventPayload const &payload) {
+      if (_wait != Wait::EVENT) return;
+      if (!_awaitAnyEvent && event != _awaitedEvent) return;
+      _lastEvent = event;
+      _lastPayload = &payload;
+      _resumeCoroutine();
+    }
+
+  protected:
+    struct EventAwaiter {
+      CoroutineState *state;
+      EventEnum      event;
+
+      bool await_ready() const { return false; }
+      void await_suspend(std::coroutine_handle<>) { state->_waitForEvent(event, false); }
+      EventPayload const &await_resume() const { return *state->_lastPayload; }
+    };
+
+    struct AnyEventAwaiter {
+      CoroutineState *state;
+
+      bool await_ready() const { return false; }
+      void await_suspend(std::coroutine_handle<>) { state->_waitForEvent(EventEnum(), true); }
+      EventEnum await_resume() const { return state->_lastEvent; }
+    };
+
+    struct UpdatesAwaiter {
+      CoroutineState *state;
+      unsigned int   updates;
+
+      bool await_ready() const { return updates == 0; }
+      void await_suspend(std::coroutine_handle<>) {
+        state->_wait = Wait::UPDATES;
+        state->_updatesLeft = updates;
+      }
+      void await_resume() const {}
+    };
+
+    template <class Predicate>
+    struct ConditionAwaiter {
+      CoroutineState *state;
+      Predicate      predicate;
+
+      bool await_ready() { return predicate(); }
+      void await_suspend(std::coroutine_handle<>) {
+        // The awaiter lives in the coroutine frame while suspended, so the state can point to its predicate
+        state->_wait = Wait::CONDITION;
+        state->_conditionContext = this;
+        state->_condition = [](void *ctx) { return static_cast<bool>(static_cast<ConditionAwaiter *>(ctx)->predicate()); };
+      }
+      void await_resume() const {}
+    };
+
+    /**
+     * @brief co_await-able: resumes when the given event is received. Returns the event payload.
+     * The payload reference is only valid until the next co_await
+     */
+    EventAwaiter awaitEvent(EventEnum event) { return {this, event}; }
+
+    /**
+     * @brief co_await-able: resumes when any event is received. Returns the event.
+     * The payload can be read with lastPayload(), until the next co_await
+     */
+    AnyEventAwaiter awaitAnyEvent() { return {this}; }
+
+    /**
+     * @brief co_await-able: resumes after the given number of calls to update()
+     */
+    UpdatesAwaiter awaitUpdates(unsigned int updates) { return {this, updates}; }
+
+    /**
+     * @brief co_await-able: resumes on the first update() where the predicate returns true
+     */
+    template <class Predicate>
+    ConditionAwaiter<Predicate> awaitCondition(Predicate predicate) { return {this, predicate}; }
+
+    EventEnum           lastEvent() const { return _lastEvent; }
+    EventPayload const &lastPayload() const { return *_lastPayload; }
+
+  private:
+    enum class Wait {
+      NONE,
+      EVENT,
+      UPDATES,
+      CONDITION,
+    };
+
+    void *_allocateFrame(size_t size) {
+      if (size > FRAME_SIZE || _frameInUse) return nullptr;
+      _frameInUse = true;
+      return _frame;
+    }
+
+    void _waitForEvent(EventEnum event, bool any) {
+      _wait = Wait::EVENT;
+      _awaitedEvent = event;
+      _awaitAnyEvent = any;
+    }
+
+    void _startCoroutine() {
+      _destroyCoroutine();
+      _task = run();
+      if (!_task) std::terminate();  // The coroutine frame does not fit in FRAME_SIZE bytes
+      _resumeCoroutine();
+    }
+
+    void _resumeCoroutine() {
+      _wait = Wait::NONE;
+      _resuming = true;
+      _task._handle.resume();
+      _resuming = false;
+
+      if (_exitPending || _restartPending) {
+        _exitPending = false;
+        _destroyCoroutine();
+      }
+      if (_restartPending) {
+        _restartPending = false;
+        _startCoroutine();
+      }
+    }
+
+    void _destroyCoroutine() {
+      _wait = Wait::NONE;
+      if (_task) {
+        _task._handle.destroy();
+        _task._handle = nullptr;
+      }
+      _frameInUse = false;
+    }
+
+    Task                _task;
+    Wait                _wait = Wait::NONE;
+    EventEnum           _awaitedEvent = EventEnum();
+    bool                _awaitAnyEvent = false;
+    EventEnum           _lastEvent = EventEnum();
+    EventPayload const *_lastPayload = nullptr;
+    unsigned int        _updatesLeft = 0;
+    bool                (*_condition)(void *) = nullptr;
+    void                *_conditionContext = nullptr;
+
+    bool                _resuming = false;
+    bool                _exitPending = false;
+    bool                _restartPending = false;
+    bool                _frameInUse = false;
+    alignas(std::max_align_t) unsigned char _frame[FRAME_SIZE];
+  };
+};
@@ -0,0 +1,299 @@
+#pragma once
+#include <type_traits>
+#include "./SimpleFSM.hpp"
+#include "./HookableFSM.hpp"
+#include "./PermissionedFSM.hpp"
+#include "./ThreadSafeFSM.hpp"
+
+namespace SimpleFSM {
+  /**
+   * @brief The kind of a policy given to FSMBuilder. An FSM can have at most one policy of each kind
+   */
+  enum class PolicyKind {
+    HOOKS,
+    PERMISSIONS,
+    THREAD_SAFETY,
+  };
+
+  /**
+   * @brief Policy: transition & event hooks, called synchronously (see HookableFSM)
+   */
+  struct Hooks {
+    static constexpr PolicyKind kind = PolicyKind::HOOKS;
+    template <class StateEnum, class EventEnum, class EventPayload>
+    using Mixin = HookRegistry<StateEnum, EventEnum, EventPayload, 0>;
+  };
+
+  /**
+   * @brief Policy: transition & event hooks, buffered and called by dispatchHooks() (see HookableFSM)
+   */
+  template <unsigned int HOOK_BUFFER_SIZE>
+  struct AsyncHooks {
+    static_assert(HOOK_BUFFER_SIZE > 0, "AsyncHooks needs a buffer size greater than 0");
+    static constexpr PolicyKind kind = PolicyKind::HOOKS;
+    template <class StateEnum, class EventEnum, class EventPayload>
+    using Mixin = HookRegistry<StateEnum, EventEnum, EventPayload, HOOK_BUFFER_SIZE>;
+  };
+
+  /**
+   * @brief Policy: runtime allowed / forbidden states (see PermissionedFSM)
+   */
+  struct Permissions {
+    static constexpr PolicyKind kind = PolicyKind::PERMISSIONS;
+    template <class StateEnum, class EventEnum, class EventPayload>
+    using Mixin = PermissionRules<StateEnum>;
+  };
+
+  /**
+   * @brief Policy: thread-safety, with an optional event queue (see ThreadSafeFSM)
+   */
+  template <class ConcurrencyPlatform, unsigned int EVENT_QUEUE_SIZE = 0,
+            ThreadSafetyMode MODE = ThreadSafetyMode::MUTEX>
+  struct ThreadSafe {
+    static constexpr PolicyKind kind = PolicyKind::THREAD_SAFETY;
+    static constexpr unsigned int eventQueueSize = EVENT_QUEUE_SIZE;
+    template <class StateEnum, class EventEnum, class EventPayload>
+    using Mixin = ThreadSafety<StateEnum, EventEnum, EventPayload, ConcurrencyPlatform, EVENT_QUEUE_SIZE, MODE>;
+  };
+
+  namespace detail {
+    struct NoMixin {};
+
+    struct NoPolicy {
+      static constexpr unsigned int eventQueueSize = 0;
+      template <class StateEnum, class EventEnum, class EventPayload>
+      using Mixin = NoMixin;
+    };
+
+    template <PolicyKind KIND, class ...Policies>
+    struct FindPolicy {
+      using type = NoPolicy;
+    };
+
+    template <PolicyKind KIND, class First, class ...Rest>
+    struct FindPolicy<KIND, First, Rest...> {
+      using type = typename std::conditional<First::kind == KIND, First, typename FindPolicy<KIND, Rest...>::type>::type;
+    };
+
+    template <PolicyKind KIND, class ...Policies>
+    constexpr unsigned int countPolicies() {
+      return (0 + ... + (Policies::kind == KIND ? 1 : 0));
+    }
+
+    struct NoLock {
+      NoLock(IConcurrencyPlatform::Mutex *) {}
+    };
+  };
+
+  /**
+   * @brief An FSM extended by a set of policies, in a single class.
+   * Contrary to stacked decorators (e.g. PermissionedFSM<HookableFSM<ThreadSafeFSM<FSM>>>), every operation goes
+   * through the same pipeline, whatever the order the policies were given in:
+   *  - transit(): lock, check the permissions (redirecting if needed), transit, call the transition hooks
+   *  - emit(): queue the event if the FSM has an event queue; otherwise lock, dispatch it, call the event hooks
+   *  - update(): lock, dispatch a batch of queued events (with their hooks), check the permissions of the current state,
+   *    call loop()
+   * With a thread-safety policy, each new state is published as soon as it is entered (before its entry(), and the hooks).
+   *  - reset(): like transit() (transition hooks included), without checking the permissions
+   * Each policy also adds its own methods (onTransition(), addRule(), getStateSnapshot(), ...).
+   * Use it through FSMBuilder.
+   */
+  template <class StateEnum, class EventEnum, class EventPayload_t, class ...Policies>
+  class ComposedFSM : public FSM<StateEnum, EventEnum, EventPayload_t>,
+                      public Policies::template Mixin<StateEnum, EventEnum, EventPayload_t>... {
+    static_assert(detail::countPolicies<PolicyKind::HOOKS, Policies...>() <= 1, "Only one hooks policy can be used");
+    static_assert(detail::countPolicies<PolicyKind::PERMISSIONS, Policies...>() <= 1, "Only one permissions policy can be used");
+    static_assert(detail::countPolicies<PolicyKind::THREAD_SAFETY, Policies...>() <= 1, "Only one thread-safety policy can be used");
+
+    using Core = FSM<StateEnum, EventEnum, EventPayload_t>;
+
+    using HooksPolicy        = typename detail::FindPolicy<PolicyKind::HOOKS, Policies...>::type;
+    using PermissionsPolicy  = typename detail::FindPolicy<PolicyKind::PERMISSIONS, Policies...>::type;
+    using ThreadSafetyPolicy = typename detail::FindPolicy<PolicyKind::THREAD_SAFETY, Policies...>::type;
+
+    using HooksMixin         = typename HooksPolicy::template Mixin<StateEnum, EventEnum, EventPayload_t>;
+    using PermissionsMixin   = typename PermissionsPolicy::template Mixin<StateEnum, EventEnum, EventPayload_t>;
+    using ThreadSafetyMixin  = typename ThreadSafetyPolicy::template Mixin<StateEnum, EventEnum, EventPayload_t>;
+
+    static constexpr bool HAS_HOOKS         = !std::is_same<HooksPolicy, detail::NoPolicy>::value;
+    static constexpr bool HAS_PERMISSIONS   = !std::is_same<PermissionsPolicy, detail::NoPolicy>::value;
+    static constexpr bool HAS_THREAD_SAFETY = !std::is_same<ThreadSafetyPolicy, detail::NoPolicy>::value;
+    static constexpr unsigned int EVENT_QUEUE_SIZE = ThreadSafetyPolicy::eventQueueSize;
+
+    using Lock = typename std::conditional<HAS_THREAD_SAFETY, LockContext, detail::NoLock>::type;
+
+   public:
+    using EventPayload = EventPayload_t;
+
+    ComposedFSM() {
+      if constexpr (HAS_THREAD_SAFETY) {
+        Core::_setStateListener(&ThreadSafetyMixin::_publishState, static_cast<ThreadSafetyMixin *>(this));
+      }
+    }
+
+    FSMError start(StateEnum initialState) {
+      _checkOwnerThread();
+      Lock lock(_getMutex());
+      return Core::start(initialState);
+    }
+
+    /**
+     * @brief Resets the FSM to its initial state, even if no transition to that state are available
+     */
+    FSMError reset() {
+      _checkOwnerThread();
+      Lock lock(_getMutex());
+      return _transit(Core::getInitialState());
+    }
+
+    /**
+     * @brief Transitions to a next state.
+     * @param newState The state to transition to
+     */
+    FSMError transit(StateEnum newState) {
+      _checkOwnerThread();
+      Lock lock(_getMutex());
+      if constexpr (HAS_PERMISSIONS) {
+        auto redirect = PermissionsMixin::_checkForPermission(newState);
+        if (redirect != newState) {
+          _transit(redirect);
+          return FSMError::INVALID_PERMISSION;
+        }
+      }
+      return _transit(newState);
+    }
+
+    /**
+     * @brief Emits an event to the FSM. States can react to those events.
+     * Note: This function is asynchronous if the thread-safety policy has an event queue, synchronous otherwise
+     *
+     * @param event The event to dispatch
+     * @param payload The event payload
+     * @return FSMError
+     */
+    FSMError emit(EventEnum event, EventPayload const &payload) {
+      if constexpr (EVENT_QUEUE_SIZE != 0) {
+        return ThreadSafetyMixin::_queueEvent(event, payload);
+      } else {
+        Lock lock(_getMutex());
+        return _dispatch(event, payload);
+      }
+    }
+
+    FSMError emit(EventEnum event) {
+      constexpr bool payloadIsEmpty = ::std::is_same<EventPayload, EmptyPayload>::value;
+      static_assert(payloadIsEmpty, "Cannot call emit() without a payload if the FSM events have a payload");
+      return emit(event, EventPayload());
+    }
+
+    /**
+     * @brief Updates the FSM. Dispatches a batch of queued events, checks the current state permissions, then calls its loop()
+     */
+    FSMError update() {
+      _checkOwnerThread();
+      Lock lock(_getMutex());
+      if constexpr (EVENT_QUEUE_SIZE != 0) {
+        typename ThreadSafetyMixin::QueuedEvent ev;
+        for (unsigned int i = 0; i < EVENT_QUEUE_SIZE; ++i) {
+          if (!ThreadSafetyMixin::_popEvent(ev))
+            break;
+          _dispatch(ev.event, ev.payload);
+        }
+      }
+      if constexpr (HAS_PERMISSIONS) {
+        auto result = _enforceRules();
+        if (result != FSMError::OK) return result;
+      }
+
+      return Core::update();
+    }
+
+    /**
+     * @brief Checks the current state against the permission rules, transiting away from it if it is not allowed
+     */
+    FSMError checkRules() {
+      static_assert(HAS_PERMISSIONS, "checkRules() needs the Permissions policy");
+      _checkOwnerThread();
+      Lock lock(_getMutex());
+      return _enforceRules();
+    }
+
+    /**
+     * @brief Returns the current state. Lock-free if the FSM has a thread-safety policy
+     */
+    StateEnum getCurrentState() const {
+      if constexpr (HAS_THREAD_SAFETY) {
+        return ThreadSafetyMixin::getStateSnapshot().state;
+      } else {
+        return Core::getCurrentState();
+      }
+    }
+
+    /**
+     * @brief Whether the current state handles an event. Lock-free if the FSM has a thread-safety policy
+     */
+    bool handlesEvent(EventEnum event) const {
+      if constexpr (HAS_THREAD_SAFETY) {
+        return Core::stateHandlesEvent(getCurrentState(), event);
+      } else {
+        return Core::handlesEvent(event);
+      }
+    }
+
+   private:
+    IConcurrencyPlatform::Mutex *_getMutex() {
+      if constexpr (HAS_THREAD_SAFETY) {
+        return ThreadSafetyMixin::_mutex;
+      } else {
+        return nullptr;
+      }
+    }
+
+    void _checkOwnerThread() {
+      if constexpr (HAS_THREAD_SAFETY) {
+        ThreadSafetyMixin::_checkOwnerThread();
+      }
+    }
+
+    FSMError _transit(StateEnum newState) {
+      auto oldState = Core::getCurrentState();
+      auto result = Core::transit(newState);
+      if constexpr (HAS_HOOKS) {
+        if (result == FSMError::OK) HooksMixin::_notifyTransition(oldState, newState);
+      }
+      return result;
+    }
+
+    FSMError _dispatch(EventEnum event, EventPayload const &payload) {
+      if constexpr (HAS_HOOKS) {
+        bool handled = Core::handlesEvent(event);
+        auto result = Core::emit(event, payload);
+        if (result == FSMError::OK) HooksMixin::_notifyEvent(event, payload, handled);
+        return result;
+      } else {
+        return Core::emit(event, payload);
+      }
+    }
+
+    FSMError _enforceRules() {
+      auto state = Core::getCurrentState();
+      auto redirect = PermissionsMixin::_checkForPermission(state);
+      if (state != redirect) {
+        _transit(redirect);
+        return FSMError::INVALID_PERMISSION;
+      }
+      return FSMError::OK;
+    }
+  };
+
+  /**
+   * @brief Builds an FSM type from a set of policies, e.g.
+   *  FSMBuilder<States, Events>::with<Hooks, Permissions, ThreadSafe<FreeRTOSConcurrencyPlatform>>
+   * See ComposedFSM for the resulting pipeline
+   */
+  template <class StateEnum, class EventEnum, class EventPayload=EmptyPayload>
+  struct FSMBuilder {
+    template <class ...Policies>
+    using with = ComposedFSM<StateEnum, EventEnum, EventPayload, Policies...>;
+  };
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "./SimpleFSM.hpp"
+
+namespace SimpleFSM {
+  /**
+   * @brief Runs a group of FSMs from a single thread.
+   * Meant for ThreadSafeFSMs in ThreadSafetyMode::ACTOR: the thread calling runOnce() becomes the owner of all its FSMs,
+   * and each update() dispatches a batch of events from the FSM mailbox before calling the state loop().
+   * Any FSM type exposing update() can be added.
+   */
+  class FSMExecutor {
+  public:
+    /**
+     * @brief Adds an FSM to the executor. It must outlive the executor, and not be updated by any other thread
+     */
+    template <class Machine>
+    void add(Machine &fsm) {
+      _machines.push_back({&fsm, [](void *machine) { return static_cast<Machine *>(machine)->update(); }});
+    }
+
+    /**
+     * @brief Updates every FSM once, in the order they were added
+     * @return The number of FSMs whose update() did not return FSMError::OK
+     */
+    unsigned int runOnce() {
+      unsigned int errors = 0;
+      for (auto &machine : _machines) {
+        if (machine.update(machine.fsm) != FSMError::OK) ++errors;
+      }
+      return errors;
+    }
+
+  private:
+    struct Machine {
+      void     *fsm;
+      FSMError (*update)(void *fsm);
+    };
+
+    std::vector<Machine> _machines;
+  };
+};
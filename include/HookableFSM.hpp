@@ -1,25 +1,229 @@
 #pragma once
 #include <SimpleFSM.hpp>
+#include "./Concurrency/SpscRing.hpp"
 
 namespace SimpleFSM {
-  template <class Base,
-            class StateEnum, class EventEnum, class EventPayload_t=EmptyPayload>
-  class HookableFSM: public Base {
+  /**
+   * @brief The hooks of a HookableFSM, and their delivery (also used by FSMBuilder)
+   * See HookableFSM for HOOK_BUFFER_SIZE
+   */
+  template <class StateEnum, class EventEnum, class EventPayload_t=EmptyPayload,
+            unsigned int HOOK_BUFFER_SIZE = 0>
+  class HookRegistry {
   public:
     using TransitionHook = std::function<void (StateEnum from, StateEnum to)>;
     using EventHook = std::function<void (EventEnum event, EventPayload_t const &payload)>;
+    // Batched hooks are called once for a run of identical consecutive records, with the length of the run (1 when synchronous)
+    using BatchedTransitionHook = std::function<void (StateEnum from, StateEnum to, unsigned int count)>;
+    using BatchedEventHook = std::function<void (EventEnum event, EventPayload_t const &payload, unsigned int count)>;
 
+    /**
+     * @brief Adds a hook called for each transition
+     */
     void onTransition(TransitionHook const &hook) { _transitionHooks.push_back(hook); }
-    void onEvent(EventHook const &hook) { _eventHooks.push_back(hook); }
+    void onTransition(BatchedTransitionHook const &hook) { _batchedTransitionHooks.push_back(hook); }
+
+    /**
+     * @brief Adds a hook called for each emitted event
+     * @param includeUnhandled Whether to also call the hook for events that the current state does not handle
+     */
+    void onEvent(EventHook const &hook, bool includeUnhandled=true) { _eventHooks.push_back({hook, includeUnhandled}); }
+    void onEvent(BatchedEventHook const &hook, bool includeUnhandled=true) { _batchedEventHooks.push_back({hook, includeUnhandled}); }
+
+    /**
+     * @brief Calls the hooks for the buffered records. Only useful if HOOK_BUFFER_SIZE > 0
+     * @param maxRecords The maximum number of records to consume
+     * @return The number of records consumed (coalesced records included)
+     */
+    unsigned int dispatchHooks(unsigned int maxRecords = HOOK_BUFFER_SIZE) {
+      unsigned int consumed = 0;
+      if constexpr (HOOK_BUFFER_SIZE != 0) {
+        HookRecord record;
+        while (consumed < maxRecords && _records.pop(record)) {
+          unsigned int count = 1;
+          // Coalesce the following identical records
+          for (HookRecord const *next = _records.peek();
+               next && consumed + count < maxRecords && _isSameRecord(record, *next);
+               next = _records.peek()) {
+            _records.pop(record);
+            ++count;
+          }
+          consumed += count;
+
+          if (record.kind == HookRecord::Kind::TRANSITION) {
+            for (auto const &hook : _transitionHooks) {
+              for (unsigned int i = 0; i < count; ++i) hook(record.from, record.to);
+            }
+            for (auto const &hook : _batchedTransitionHooks) {
+              hook(record.from, record.to, count);
+            }
+          } else {
+            for (auto const &hook : _eventHooks) {
+              if (!record.handled && !hook.includeUnhandled) continue;
+              for (unsigned int i = 0; i < count; ++i) hook.hook(record.event, record.payload);
+            }
+            for (auto const &hook : _batchedEventHooks) {
+              if (record.handled || hook.includeUnhandled) hook.hook(record.event, record.payload, count);
+            }
+          }
+        }
+      }
+      return consumed;
+    }
+
+    /**
+     * @brief Returns the number of records dropped because the hook buffer was full
+     */
+    unsigned int getDroppedHookRecords() const { return _droppedRecords.load(std::memory_order_relaxed); }
+
+  protected:
+    /**
+     * @brief Calls (or buffers) the transition hooks
+     */
+    void _notifyTransition(StateEnum from, StateEnum to) {
+      if constexpr (HOOK_BUFFER_SIZE != 0) {
+        HookRecord record;
+        record.kind = HookRecord::Kind::TRANSITION;
+        record.from = from;
+        record.to = to;
+        _pushRecord(record);
+      } else {
+        _callTransitionHooks(from, to);
+      }
+    }
+
+    /**
+     * @brief Calls (or buffers) the event hooks
+     * @param handled Whether the state that received the event handles it
+     */
+    void _notifyEvent(EventEnum event, EventPayload_t const &payload, bool handled) {
+      if constexpr (HOOK_BUFFER_SIZE != 0) {
+        HookRecord record;
+        record.kind = HookRecord::Kind::EVENT;
+        record.event = event;
+        record.handled = handled;
+        record.payload = payload;
+        _pushRecord(record);
+      } else {
+        _callEventHooks(event, payload, handled);
+      }
+    }
+
+  private:
+    template <class Hook>
+    struct RegisteredEventHook {
+      Hook hook;
+      bool includeUnhandled;
+    };
+
+    struct HookRecord {
+      enum class Kind { TRANSITION, EVENT };
+
+      Kind           kind = Kind::TRANSITION;
+      StateEnum      from = StateEnum::_SIMPLE_FSM_INVALID_;
+      StateEnum      to = StateEnum::_SIMPLE_FSM_INVALID_;
+      EventEnum      event = EventEnum();
+      bool           handled = false;
+      EventPayload_t payload = EventPayload_t();
+    };
+
+    void _pushRecord(HookRecord const &record) {
+      if (!_records.push(record)) _droppedRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool _isSameRecord(HookRecord const &a, HookRecord const &b) {
+      if (a.kind != b.kind) return false;
+      if (a.kind == HookRecord::Kind::TRANSITION) return a.from == b.from && a.to == b.to;
+      // Payloads cannot be compared in general: only events without payload are coalesced
+      constexpr bool payloadIsEmpty = ::std::is_same<EventPayload_t, EmptyPayload>::value;
+      return payloadIsEmpty && a.event == b.event && a.handled == b.handled;
+    }
 
+    void _callTransitionHooks(StateEnum from, StateEnum to) {
+      for (auto const &hook : _transitionHooks) {
+        hook(from, to);
+      }
+      for (auto const &hook : _batchedTransitionHooks) {
+        hook(from, to, 1);
+      }
+    }
+
+    void _callEventHooks(EventEnum event, EventPayload_t const &payload, bool handled) {
+      for (auto const &hook : _eventHooks) {
+        if (handled || hook.includeUnhandled) hook.hook(event, payload);
+      }
+      for (auto const &hook : _batchedEventHooks) {
+        if (handled || hook.includeUnhandled) hook.hook(event, payload, 1);
+      }
+    }
+
+    struct NoRecords {};
+    using RecordBuffer = typename std::conditional<HOOK_BUFFER_SIZE != 0, SpscRing<HookRecord, HOOK_BUFFER_SIZE>, NoRecords>::type;
+
+    std::vector<TransitionHook>                          _transitionHooks;
+    std::vector<BatchedTransitionHook>                   _batchedTransitionHooks;
+    std::vector<RegisteredEventHook<EventHook>>          _eventHooks;
+    std::vector<RegisteredEventHook<BatchedEventHook>>   _batchedEventHooks;
+    RecordBuffer                                         _records;
+    std::atomic<unsigned int>                            _droppedRecords{0};
+  };
+
+  /**
+   * @brief Calls hooks on transitions and events.
+   *
+   * @tparam HOOK_BUFFER_SIZE If 0, hooks are called synchronously, inside emit() / transit().
+   *  Otherwise, emit() / transit() only append a record to a lock-free buffer of that size, and hooks are called
+   *  when another thread calls dispatchHooks(). Runs of identical consecutive records are coalesced: batched hooks are
+   *  called once with the length of the run, other hooks once per record.
+   *  Records are dropped (see getDroppedHookRecords()) when the buffer is full.
+   *  In that mode, records must be pushed by a single thread at a time. That is the case below a ThreadSafeFSM, and above it too,
+   *  as it reports events and transitions under its lock (see ThreadSafeFSM::DispatchObserver), or from the owner thread of an actor.
+   *  Otherwise, emit() / transit() must not be called concurrently. dispatchHooks() must be called from a single other thread,
+   *  and hooks must all be added before the first dispatchHooks()
+   *
+   * Placed above a ThreadSafeFSM, synchronous hooks are called by the ThreadSafeFSM, with its lock held.
+   * A hook must then never wait for another thread that uses the same FSM (e.g. joining it, or waiting on its result):
+   * that thread would block on the lock, and both would deadlock. Use HOOK_BUFFER_SIZE > 0 to run hooks outside of the lock
+   */
+  template <class Base,
+            class StateEnum, class EventEnum, class EventPayload_t=EmptyPayload,
+            unsigned int HOOK_BUFFER_SIZE = 0>
+  class HookableFSM: public Base, public HookRegistry<StateEnum, EventEnum, EventPayload_t, HOOK_BUFFER_SIZE> {
+    using Hooks = HookRegistry<StateEnum, EventEnum, EventPayload_t, HOOK_BUFFER_SIZE>;
+
+    template <class B, class = void>
+    struct ObservesDispatch : std::false_type {};
+    template <class B>
+    struct ObservesDispatch<B, std::void_t<typename B::DispatchObserver>> : std::true_type {};
+
+  public:
+    HookableFSM() {
+      if constexpr (ObservesDispatch<Base>::value) {
+        Base::_setDispatchObserver([this](EventEnum event, EventPayload_t const &payload, bool handled) {
+          Hooks::_notifyEvent(event, payload, handled);
+        });
+        Base::_setTransitionObserver([this](StateEnum from, StateEnum to) {
+          Hooks::_notifyTransition(from, to);
+        });
+      }
+    }
+
+    /**
+     * @brief Emits an event, then calls the event hooks.
+     * Above a ThreadSafeFSM, the event hooks are called by the ThreadSafeFSM, under its lock, when it dispatches the event
+     * (on update() if it has an event queue). Transition hooks likewise
+     */
     FSMError emit(EventEnum event, EventPayload_t const &payload) {
-      auto result = Base::emit(event, payload);
-      if (result == FSMError::OK) {
-        for (auto const &hook : _eventHooks) {
-          hook(event, payload);
+      if constexpr (ObservesDispatch<Base>::value) {
+        return Base::emit(event, payload);
+      } else {
+        bool handled = Base::handlesEvent(event);
+        auto result = Base::emit(event, payload);
+        if (result == FSMError::OK) {
+          Hooks::_notifyEvent(event, payload, handled);
         }
+        return result;
       }
-      return result;
     }
 
     FSMError emit(EventEnum event) {
@@ -27,18 +231,32 @@ namespace SimpleFSM {
     }
 
     FSMError transit(StateEnum newState) {
-      auto oldState = Base::getCurrentState();
-      auto result = Base::transit(newState);
-      if (result == FSMError::OK) {
-        for (auto const &hook : _transitionHooks) {
-          hook(oldState, newState);
+      if constexpr (ObservesDispatch<Base>::value) {
+        return Base::transit(newState);
+      } else {
+        auto oldState = Base::getCurrentState();
+        auto result = Base::transit(newState);
+        if (result == FSMError::OK) {
+          Hooks::_notifyTransition(oldState, newState);
         }
+        return result;
       }
-      return result;
     }
 
-  private:
-    std::vector<TransitionHook>  _transitionHooks;
-    std::vector<EventHook>       _eventHooks;
+    /**
+     * @brief Resets the FSM to its initial state. Like transit(), it calls the transition hooks
+     */
+    FSMError reset() {
+      if constexpr (ObservesDispatch<Base>::value) {
+        return Base::reset();
+      } else {
+        auto oldState = Base::getCurrentState();
+        auto result = Base::reset();
+        if (result == FSMError::OK) {
+          Hooks::_notifyTransition(oldState, Base::getInitialState());
+        }
+        return result;
+      }
+    }
   };
-}
\ No newline at end of file
+}
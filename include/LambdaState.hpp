@@ -28,6 +28,12 @@ namespace SimpleFSM {
     LambdaState(StateEnum state, Config const &cfg, char const *name=nullptr)
     : BaseState(state), _entry(cfg.entry), _react(cfg.react), _exit(cfg.exit), _loop(cfg.loop), _name(name) {}
 
+    /**
+     * @param handledEvents The events for which react() is called (see eventMask())
+     */
+    LambdaState(StateEnum state, Config const &cfg, EventMask handledEvents, char const *name=nullptr)
+    : BaseState(state, handledEvents), _entry(cfg.entry), _react(cfg.react), _exit(cfg.exit), _loop(cfg.loop), _name(name) {}
+
     virtual void entry()                                             { if (_entry) _entry(); }
     virtual void loop()                                              { if (_loop)  _loop(); }
     virtual void exit()                                              { if (_exit)  _exit(); }
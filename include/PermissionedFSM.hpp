@@ -1,32 +1,108 @@
 #pragma once
 #include <SimpleFSM.hpp>
+#include <atomic>
 #include <vector>
 
-#ifndef SIMPLE_FSM_MAX_RULES_RESERVED // Defines how many rules we reserve space for before having to use reallocs
+#ifndef SIMPLE_FSM_MAX_RULES_RESERVED // Defines how many rules we reserve space for before having to allocate
 # define SIMPLE_FSM_MAX_RULES_RESERVED 8
 #endif
 
 namespace SimpleFSM {
-  template <class Base, class StateEnum>
-  class PermissionedFSM : public Base {
+  /**
+   * @brief The rules and rejection callbacks of a PermissionedFSM (also used by FSMBuilder)
+   */
+  template <class StateEnum>
+  class PermissionRules {
     public:
-    PermissionedFSM() {
-      _rules.reserve(SIMPLE_FSM_MAX_RULES_RESERVED);
-    }
-
     using Rule                        = std::function<StateEnum (StateEnum state)>;
     using PermissionRejectedCallback  = std::function<void (StateEnum to)>;
 
+    PermissionRules() = default;
+    PermissionRules(PermissionRules const &) = delete;
+    PermissionRules &operator=(PermissionRules const &) = delete;
+
+    ~PermissionRules() {
+      RuleNode *node = _firstRule.load(std::memory_order_relaxed);
+      for (size_t i = 0; node; ++i) {
+        RuleNode *next = node->next.load(std::memory_order_relaxed);
+        if (i >= SIMPLE_FSM_MAX_RULES_RESERVED) delete node;
+        node = next;
+      }
+    }
+
+    /**
+     * @brief Adds a rule. Rules are only appended, and published without locking:
+     * wouldAllowState() can safely run on other threads meanwhile.
+     * addRule() itself must not be called concurrently
+     */
     void addRule(Rule rule) {
-      _rules.push_back(rule);
+      RuleNode *node = (_ruleCount < SIMPLE_FSM_MAX_RULES_RESERVED) ? &_reservedRules[_ruleCount] : new RuleNode();
+      ++_ruleCount;
+      node->rule = rule;
+      if (_lastRule) {
+        _lastRule->next.store(node, std::memory_order_release);
+      } else {
+        _firstRule.store(node, std::memory_order_release);
+      }
+      _lastRule = node;
     }
 
     void onPermissionRejection(PermissionRejectedCallback cb) {
       _rejectCallbacks.push_back(cb);
     }
 
+    /**
+     * @brief Checks a state against the rules, without triggering the rejection callbacks.
+     * Lock-free: can be called from any thread, as long as the rules themselves are thread-safe
+     */
+    bool wouldAllowState(StateEnum state) const {
+      return _findRedirect(state) == state;
+    }
+
+  protected:
+    /**
+     * @brief Checks a state against the rules, triggering the rejection callbacks if it is not allowed
+     * @return The state to go to instead, or the state itself if it is allowed
+     */
+    StateEnum _checkForPermission(StateEnum newState) {
+      auto redirect = _findRedirect(newState);
+      if (redirect != newState) {
+        for (auto &cb : _rejectCallbacks) {
+          cb(newState);
+        }
+      }
+      return redirect;
+    }
+
+  private:
+    struct RuleNode {
+      Rule                    rule;
+      std::atomic<RuleNode *> next{nullptr};
+    };
+
+    StateEnum _findRedirect(StateEnum newState) const {
+      for (RuleNode const *node = _firstRule.load(std::memory_order_acquire); node;
+           node = node->next.load(std::memory_order_acquire)) {
+        auto redirect = node->rule(newState);
+        if (redirect != newState) return redirect;
+      }
+      return newState;
+    }
+
+      RuleNode                                _reservedRules[SIMPLE_FSM_MAX_RULES_RESERVED];
+      size_t                                  _ruleCount = 0;
+      std::atomic<RuleNode *>                 _firstRule{nullptr};
+      RuleNode                                *_lastRule = nullptr;
+      std::vector<PermissionRejectedCallback> _rejectCallbacks;
+  };
+
+  template <class Base, class StateEnum>
+  class PermissionedFSM : public Base, public PermissionRules<StateEnum> {
+    using Rules = PermissionRules<StateEnum>;
+
+    public:
     FSMError transit(StateEnum newState) {
-      auto redirect = _checkForPermission(newState);
+      auto redirect = Rules::_checkForPermission(newState);
       if (redirect != newState) {
         _forceTransit(redirect);
         return FSMError::INVALID_PERMISSION;
@@ -36,7 +112,7 @@ namespace SimpleFSM {
 
     FSMError update() {
       auto state = Base::getCurrentState();
-      auto redirect = _checkForPermission(state);
+      auto redirect = Rules::_checkForPermission(state);
       if (state != redirect) {
         _forceTransit(redirect);
         return FSMError::INVALID_PERMISSION;
@@ -46,7 +122,7 @@ namespace SimpleFSM {
 
     FSMError checkRules() {
       auto state = Base::getCurrentState();
-      auto redirect = _checkForPermission(state);
+      auto redirect = Rules::_checkForPermission(state);
       if (state != redirect) {
         _forceTransit(redirect);
         return FSMError::INVALID_PERMISSION;
@@ -54,31 +130,9 @@ namespace SimpleFSM {
       return FSMError::OK;
     }
 
-    bool wouldAllowState(StateEnum state) {
-      return _checkForPermission(state, false) == state;
-    }
-
   private:
     FSMError _forceTransit(StateEnum state) {
       return Base::transit(state);
     }
-
-    StateEnum _checkForPermission(StateEnum newState, bool triggerCallbacks=true) {
-      for (auto &rule : _rules) {
-        auto redirect = rule(newState);
-        if (redirect != newState) {
-          if (triggerCallbacks) {
-            for (auto &cb : _rejectCallbacks) {
-              cb(newState);
-            }
-          }
-          return redirect;
-        }
-      }
-      return newState;
-    }
-
-      std::vector<Rule>                       _rules;
-      std::vector<PermissionRejectedCallback> _rejectCallbacks;
   };
 };
@@ -1,7 +1,17 @@
 #pragma once
 #include <functional>
+#include <stdint.h>
+#include <memory>
 #include <type_traits>
+#include <utility>
 #include <vector>
+#include "./StateArena.hpp"
+
+// Defines how many bytes per state the FSM's own arena reserves at least, when no size is given.
+// The default fits the library's own states (a LambdaState, or a CoroutineState with its default frame size)
+#ifndef SIMPLE_FSM_STATE_ARENA_BYTES_PER_STATE
+# define SIMPLE_FSM_STATE_ARENA_BYTES_PER_STATE 512
+#endif
 
 namespace SimpleFSM {
   /**
@@ -17,10 +27,28 @@ namespace SimpleFSM {
     MISSING_STATE,
     INVALID_PERMISSION,
     ASYNC_OPERATION_ERROR,
+    OUT_OF_MEMORY,
+    ARENA_ALREADY_SET,
   };
 
   struct EmptyPayload {};
 
+  /**
+   * @brief A set of events, one bit per event value.
+   * Events whose value is 64 or more cannot be represented, and are always considered handled
+   */
+  using EventMask = uint64_t;
+  constexpr EventMask ALL_EVENTS = ~EventMask(0);
+
+  /**
+   * @brief Builds an EventMask from a compile-time list of events
+   */
+  template <auto ...events>
+  constexpr EventMask eventMask() {
+    static_assert(((static_cast<size_t>(events) < 64) && ...), "Events used in an EventMask must have a value lower than 64");
+    return (EventMask(0) | ... | (EventMask(1) << static_cast<size_t>(events)));
+  }
+
   /**
    * @brief The Finite State Machine
    * 
@@ -44,11 +72,14 @@ namespace SimpleFSM {
       /**
        * @brief The base class for the FSM's state.
        * It is virtual pure, so needs to be inherited
+       * The FSM only calls react() for the events in handledEvents (see eventMask()), all others are skipped
        */
       class State {
       public:
-        State(StateEnum state): _state(state) {}
+        State(StateEnum state, EventMask handledEvents=ALL_EVENTS): _state(state), _handledEvents(handledEvents) {}
+        virtual ~State() = default;
         StateEnum getValue() const { return _state; }
+        EventMask getHandledEvents() const { return _handledEvents; }
 
         virtual void entry() = 0;
         virtual void loop() = 0;
@@ -57,6 +88,7 @@ namespace SimpleFSM {
         virtual char const *getName() const { return "?"; }
       private:
         StateEnum _state;
+        EventMask _handledEvents;
       };
 
       /**
@@ -65,15 +97,86 @@ namespace SimpleFSM {
        * @param state A pointer to the State to add
        */
       FSMError addState(State *state) {
+        if (!state) return FSMError::BAD_STATE;
+        return addState(state, state->getHandledEvents());
+      }
+
+      /**
+       * @brief Adds a state to the FSM, overriding the events it handles.
+       * @param state A pointer to the State to add
+       * @param handledEvents The events for which react() is called (see eventMask())
+       */
+      FSMError addState(State *state, EventMask handledEvents) {
         if (!state) return FSMError::BAD_STATE;
         auto s = state->getValue();
         if (_started) return FSMError::FSM_ALREADY_STARTED;
         if (s >= StateEnum::_SIMPLE_FSM_INVALID_) return FSMError::BAD_STATE; //TODO: Make sure enums are unsigned
         if (getStatePointer(s) != nullptr) return FSMError::STATE_ALREADY_SET;
         _states[to_size_t(s)] = state;
+        _handledEvents[to_size_t(s)] = handledEvents;
         return FSMError::OK;
       }
 
+      /**
+       * @brief Builds a state inside the FSM's arena, and adds it to the FSM.
+       * States built this way are owned by the FSM, and destroyed with it.
+       * If no arena was given (useStateArena) or reserved (reserveStates), the FSM allocates its own arena on the first call,
+       * with room for every state, each taking SIMPLE_FSM_STATE_ARENA_BYTES_PER_STATE bytes or the size of T if bigger.
+       * If its own arena is full (a later state being bigger than the first one), the FSM allocates another one.
+       * An arena given with useStateArena() is never grown: OUT_OF_MEMORY is returned when it is full.
+       * @tparam T The type of the state to build
+       * @param args The arguments given to the state constructor
+       */
+      template <class T, class ...Args>
+      FSMError emplaceState(Args &&...args) {
+        if (_started) return FSMError::FSM_ALREADY_STARTED;
+        constexpr size_t stateBytes = sizeof(T) + alignof(T);
+        if (!_arena) _growOwnedArena(stateBytes);
+        T *state = _arena->template make<T>(std::forward<Args>(args)...);
+        if (!state && _ownsArena()) {
+          // Nothing was built, so the arguments can be forwarded again
+          _growOwnedArena(stateBytes);
+          state = _arena->template make<T>(std::forward<Args>(args)...);
+        }
+        if (!state) return FSMError::OUT_OF_MEMORY;
+        auto result = addState(state);
+        if (result != FSMError::OK) {
+          state->~T();  // Its memory is only reclaimed with the arena
+          return result;
+        }
+        _ownedStates[to_size_t(state->getValue())] = true;
+        return FSMError::OK;
+      }
+
+      /**
+       * @brief Allocates the FSM's own arena, in which emplaceState() builds states.
+       * Must be called before the first emplaceState(), and without useStateArena(): ARENA_ALREADY_SET is returned otherwise
+       * @param bytes The arena capacity, which should fit all emplaced states
+       */
+      FSMError reserveStates(size_t bytes) {
+        if (_started) return FSMError::FSM_ALREADY_STARTED;
+        if (_arena && (!_ownsArena() || _arena->getUsed() > 0)) return FSMError::ARENA_ALREADY_SET;
+        _ownedArenas.clear();
+        _ownedArenas.emplace_back(new StateArena(bytes));
+        _arena = _ownedArenas.back().get();
+        return FSMError::OK;
+      }
+
+      /**
+       * @brief Makes emplaceState() build states inside an external arena, which can be shared by several FSMs.
+       * The arena must outlive the FSM. States emplaced before this call are left where they are.
+       * The FSM never grows nor replaces this arena
+       */
+      void useStateArena(StateArena &arena) {
+        _arena = &arena;
+      }
+
+      ~FSM() {
+        for (size_t i = 0; i < to_size_t(StateEnum::_SIMPLE_FSM_INVALID_); ++i) {
+          if (_ownedStates[i]) _states[i]->~State();
+        }
+      }
+
       /**
        * @brief Freezes the states & transitions, and starts calling the states methods
        * 
@@ -87,6 +190,7 @@ namespace SimpleFSM {
         _initialState = initialState;
         _currentState = _initialState;
         _started = true;
+        if (_stateListener) _stateListener(_stateListenerContext, _currentState, false);
         getStatePointer(_currentState)->entry();
         return FSMError::OK;
       }
@@ -107,6 +211,7 @@ namespace SimpleFSM {
         if (!_started) return FSMError::FSM_NOT_STARTED;
         getStatePointer(_currentState)->exit();
         _currentState = newState;
+        if (_stateListener) _stateListener(_stateListenerContext, _currentState, true);
         getStatePointer(_currentState)->entry();
         return FSMError::OK;
       }
@@ -114,6 +219,7 @@ namespace SimpleFSM {
       /**
        * @brief Emits an event to the FSM. States can react to those events.
        * Note: This function is synchronous.
+       * Events not handled by the current state are skipped without calling react()
        * 
        * @param event The event to dispatch
        * @param payload The event payload
@@ -121,6 +227,7 @@ namespace SimpleFSM {
        */
       FSMError emit(EventEnum event, EventPayload const &payload) {
         if (!_started) return FSMError::FSM_NOT_STARTED;
+        if (!handlesEvent(event)) return FSMError::OK;
 
         getStatePointer(_currentState)->react(event, payload);
         return FSMError::OK;
@@ -141,13 +248,71 @@ namespace SimpleFSM {
         return FSMError::OK;
       }
 
+      /**
+       * @brief Whether the current state handles an event, i.e. whether emitting it would call react()
+       */
+      bool handlesEvent(EventEnum event) const {
+        if (!_started) return false;
+        return stateHandlesEvent(_currentState, event);
+      }
+
+      /**
+       * @brief Whether a given state handles an event. States must all be added before calling it concurrently
+       */
+      bool stateHandlesEvent(StateEnum state, EventEnum event) const {
+        if (state >= StateEnum::_SIMPLE_FSM_INVALID_) return false;
+        size_t bit = to_size_t(event);
+        return bit >= 64 || (_handledEvents[to_size_t(state)] & (EventMask(1) << bit));
+      }
+
       StateEnum getCurrentState() const { return _currentState; }
+      StateEnum getInitialState() const { return _initialState; }
       State    *getStatePointer(StateEnum s) { return _states[to_size_t(s)]; }
 
+    protected:
+      /**
+       * @brief Called on every change of the current state, right before the entry() of the new state
+       * @param transition false when called by start(), true when called by transit()
+       */
+      using StateListener = void (*)(void *context, StateEnum state, bool transition);
+
+      /**
+       * @brief Sets the state listener, used by thread-safe FSMs to publish the current state
+       */
+      void _setStateListener(StateListener listener, void *context) {
+        _stateListener = listener;
+        _stateListenerContext = context;
+      }
+
     private:
       bool      _started = false;
       StateEnum _initialState = StateEnum::_SIMPLE_FSM_INVALID_;
       StateEnum _currentState = StateEnum::_SIMPLE_FSM_INVALID_;
       State    *_states[to_size_t(StateEnum::_SIMPLE_FSM_INVALID_)] = {nullptr};
+      EventMask _handledEvents[to_size_t(StateEnum::_SIMPLE_FSM_INVALID_)] = {0};
+      bool      _ownedStates[to_size_t(StateEnum::_SIMPLE_FSM_INVALID_)] = {false};
+      StateArena                               *_arena = nullptr;
+      std::vector<std::unique_ptr<StateArena>>  _ownedArenas;
+      StateListener                             _stateListener = nullptr;
+      void                                     *_stateListenerContext = nullptr;
+
+      bool _ownsArena() const {
+        return !_ownedArenas.empty() && _arena == _ownedArenas.back().get();
+      }
+
+      /**
+       * @brief Allocates a new arena owned by the FSM, with room for all the states not added yet
+       * @param stateBytes The room needed by the state about to be emplaced
+       */
+      void _growOwnedArena(size_t stateBytes) {
+        size_t missingStates = 0;
+        for (size_t i = 0; i < to_size_t(StateEnum::_SIMPLE_FSM_INVALID_); ++i) {
+          if (_states[i] == nullptr) ++missingStates;
+        }
+        if (missingStates == 0) missingStates = 1;
+        size_t bytesPerState = (stateBytes > SIMPLE_FSM_STATE_ARENA_BYTES_PER_STATE) ? stateBytes : SIMPLE_FSM_STATE_ARENA_BYTES_PER_STATE;
+        _ownedArenas.emplace_back(new StateArena(bytesPerState * missingStates));
+        _arena = _ownedArenas.back().get();
+      }
   };
 };
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+#include "../SimpleFSM.hpp"
+
+namespace SimpleFSM {
+  /**
+   * @brief A small, portable PRNG (xorshift64*): the same seed gives the same sequence on every platform
+   */
+  class SimulationRandom {
+  public:
+    SimulationRandom(uint64_t seed): _state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+
+    uint64_t next() {
+      _state ^= _state >> 12;
+      _state ^= _state << 25;
+      _state ^= _state >> 27;
+      return _state * 0x2545F4914F6CDD1Dull;
+    }
+
+    /**
+     * @brief Returns a number in [0, bound)
+     */
+    uint32_t nextBelow(uint32_t bound) {
+      return static_cast<uint32_t>((next() >> 32) * bound >> 32);
+    }
+
+  private:
+    uint64_t _state;
+  };
+
+  /**
+   * @brief Generates a reproducible stream of events, following a weighted distribution
+   * (e.g. the event frequencies observed in production)
+   */
+  template <class EventEnum, class EventPayload=EmptyPayload>
+  class EventGenerator {
+  public:
+    using PayloadFactory = std::function<EventPayload (EventEnum event, SimulationRandom &random)>;
+
+    struct Event {
+      EventEnum    event;
+      EventPayload payload;
+    };
+
+    EventGenerator(uint64_t seed): _random(seed) {}
+
+    /**
+     * @brief Sets the relative frequency of an event. Events without a weight are never generated
+     */
+    void setWeight(EventEnum event, uint32_t weight) {
+      for (auto &entry : _weights) {
+        if (entry.event == event) {
+          _totalWeight = _totalWeight - entry.weight + weight;
+          entry.weight = weight;
+          return;
+        }
+      }
+      _weights.push_back({event, weight});
+      _totalWeight += weight;
+    }
+
+    /**
+     * @brief Sets the function building payloads. Without one, payloads are default-constructed
+     */
+    void setPayloadFactory(PayloadFactory const &factory) { _payloadFactory = factory; }
+
+    /**
+     * @brief Generates the next event. At least one event must have a non-zero weight
+     */
+    Event next() {
+      uint32_t pick = _random.nextBelow(_totalWeight);
+      EventEnum event = _weights.back().event;
+      for (auto const &entry : _weights) {
+        if (pick < entry.weight) {
+          event = entry.event;
+          break;
+        }
+        pick -= entry.weight;
+      }
+      return {event, _payloadFactory ? _payloadFactory(event, _random) : EventPayload()};
+    }
+
+    SimulationRandom &getRandom() { return _random; }
+
+  private:
+    struct Weight {
+      EventEnum event;
+      uint32_t  weight;
+    };
+
+    SimulationRandom    _random;
+    std::vector<Weight> _weights;
+    uint32_t            _totalWeight = 0;
+    PayloadFactory      _payloadFactory;
+  };
+};
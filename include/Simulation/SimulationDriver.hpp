@@ -0,0 +1,187 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../SimpleFSM.hpp"
+#include "../Concurrency/SimulatedConcurrencyPlatform.hpp"
+#include "./EventGenerator.hpp"
+
+namespace SimpleFSM {
+  /**
+   * @brief Runs a fleet of FSMs through a generated stream of events, as fast as the CPU allows, and measures them.
+   * Events are sent to randomly picked machines, and the virtual clock of SimulatedConcurrencyPlatform
+   * is advanced between events, so timing-dependent state logic runs as it would on the device.
+   * With the same seed and setup, two runs go through exactly the same states.
+   *
+   * Transitions and state visits are counted exactly when the machine has transition hooks (HookableFSM, or the
+   * Hooks / AsyncHooks policies of FSMBuilder): the driver adds its own hook, and dispatches buffered hooks after each call.
+   * Otherwise, they are observed by comparing the state before and after each emit / update, which only counts
+   * the state reached at the end of the call (the transitions in between are still counted by getStateSnapshot(), if any).
+   */
+  template <class Machine, class StateEnum, class EventEnum, class EventPayload=EmptyPayload>
+  class SimulationDriver {
+  private:
+    template<class T>
+    constexpr static size_t to_size_t(T v) { return static_cast<size_t>(v); };
+
+  public:
+    /**
+     * @brief Adds the states to a machine, and starts it
+     */
+    using Setup = std::function<void (Machine &fsm, size_t index)>;
+
+    struct Config {
+      size_t   machines;
+      uint64_t events;
+      uint32_t eventsPerUpdate = 1;  // A machine is updated after receiving this many events
+      uint32_t msPerEvent = 1;       // Virtual time elapsed between two events
+    };
+
+    struct Report {
+      uint64_t events = 0;
+      uint64_t updates = 0;
+      uint64_t transitions = 0;
+      uint64_t errors = 0;  // emit / update calls that did not return FSMError::OK
+      double   seconds = 0;
+      uint64_t stateVisits[to_size_t(StateEnum::_SIMPLE_FSM_INVALID_)] = {0};
+
+      double eventsPerSecond() const { return seconds > 0 ? events / seconds : 0; }
+      double transitionsPerSecond() const { return seconds > 0 ? transitions / seconds : 0; }
+    };
+
+    SimulationDriver(Config const &config, Setup const &setup): _config(config) {
+      _machines.reserve(config.machines);
+      _observed.resize(config.machines);
+      for (size_t i = 0; i < config.machines; ++i) {
+        _machines.emplace_back(new Machine());
+        if constexpr (HasTransitionHooks<Machine>::value) {
+          _machines.back()->onTransition([this](StateEnum, StateEnum to) {
+            if (!_report) return;
+            ++_report->transitions;
+            _countVisit(*_report, to);
+          });
+        }
+        setup(*_machines.back(), i);
+      }
+    }
+
+    // The machines' hooks point to the driver
+    SimulationDriver(SimulationDriver const &) = delete;
+    SimulationDriver &operator=(SimulationDriver const &) = delete;
+
+    /**
+     * @brief Runs the simulation. The virtual clock is reset to 0 beforehand
+     */
+    Report run(EventGenerator<EventEnum, EventPayload> &generator) {
+      Report report;
+      if (_machines.empty()) return report;
+      for (auto &machine : _machines) _dispatchHooks(*machine);  // Transitions made by the setup are not counted
+      _report = &report;
+
+      SimulatedConcurrencyPlatform::clock().setTimeMs(0);
+      for (size_t i = 0; i < _machines.size(); ++i) {
+        _observed[i] = {_machines[i]->getCurrentState(), _getTransitions(*_machines[i]), 0};
+        _countVisit(report, _observed[i].state);
+      }
+
+      auto begin = std::chrono::steady_clock::now();
+      for (uint64_t i = 0; i < _config.events; ++i) {
+        size_t index = generator.getRandom().nextBelow(static_cast<uint32_t>(_machines.size()));
+        Machine &fsm = *_machines[index];
+        Observed &observed = _observed[index];
+
+        auto ev = generator.next();
+        if (fsm.emit(ev.event, ev.payload) != FSMError::OK) ++report.errors;
+        ++report.events;
+        _observe(report, fsm, observed);
+
+        if (++observed.eventsSinceUpdate >= _config.eventsPerUpdate) {
+          observed.eventsSinceUpdate = 0;
+          if (fsm.update() != FSMError::OK) ++report.errors;
+          ++report.updates;
+          _observe(report, fsm, observed);
+        }
+
+        SimulatedConcurrencyPlatform::clock().advance(_config.msPerEvent);
+      }
+      report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      _report = nullptr;
+      return report;
+    }
+
+    size_t   getMachineCount() const { return _machines.size(); }
+    Machine &getMachine(size_t index) { return *_machines[index]; }
+
+  private:
+    struct Observed {
+      StateEnum state;
+      uint32_t  transitions;
+      uint32_t  eventsSinceUpdate;
+    };
+
+    template <class M, class = void>
+    struct HasTransitionHooks : std::false_type {};
+    template <class M>
+    struct HasTransitionHooks<M, std::void_t<decltype(std::declval<M &>().onTransition(
+      std::declval<std::function<void (StateEnum, StateEnum)>>()))>> : std::true_type {};
+
+    template <class M, class = void>
+    struct HasHookBuffer : std::false_type {};
+    template <class M>
+    struct HasHookBuffer<M, std::void_t<decltype(std::declval<M &>().dispatchHooks())>> : std::true_type {};
+
+    template <class M, class = void>
+    struct HasSnapshot : std::false_type {};
+    template <class M>
+    struct HasSnapshot<M, std::void_t<decltype(std::declval<M const &>().getStateSnapshot())>> : std::true_type {};
+
+    static uint32_t _getTransitions(Machine const &fsm) {
+      if constexpr (HasSnapshot<Machine>::value) {
+        return fsm.getStateSnapshot().transitions;
+      } else {
+        return 0;
+      }
+    }
+
+    static void _dispatchHooks(Machine &fsm) {
+      if constexpr (HasHookBuffer<Machine>::value) {
+        while (fsm.dispatchHooks() != 0) {}
+      }
+    }
+
+    void _observe(Report &report, Machine &fsm, Observed &observed) {
+      if constexpr (HasTransitionHooks<Machine>::value) {
+        _dispatchHooks(fsm);
+      } else {
+        StateEnum state;
+        if constexpr (HasSnapshot<Machine>::value) {
+          auto snapshot = fsm.getStateSnapshot();
+          if (snapshot.transitions == observed.transitions) return;
+          report.transitions += snapshot.transitions - observed.transitions;
+          observed.transitions = snapshot.transitions;
+          state = snapshot.state;
+        } else {
+          state = fsm.getCurrentState();
+          if (state == observed.state) return;
+          ++report.transitions;
+        }
+        observed.state = state;
+        _countVisit(report, state);
+      }
+    }
+
+    void _countVisit(Report &report, StateEnum state) {
+      if (state < StateEnum::_SIMPLE_FSM_INVALID_) ++report.stateVisits[to_size_t(state)];
+    }
+
+    Config                                 _config;
+    Report                                *_report = nullptr;  // The report of the current run, filled by the transition hooks
+    std::vector<std::unique_ptr<Machine>>  _machines;
+    std::vector<Observed>                  _observed;
+  };
+};
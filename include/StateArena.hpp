@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace SimpleFSM {
+  /**
+   * @brief A fixed-capacity bump allocator, used to store state objects contiguously.
+   * The memory is allocated once, when the arena is built, and released when it is destroyed.
+   * Objects are never freed individually: their owner (the FSM) calls their destructors.
+   *
+   * An arena can be owned by a single FSM, or shared by several FSMs (it must then outlive all of them).
+   * It is not thread-safe: states must be emplaced from a single thread.
+   */
+  class StateArena {
+  public:
+    StateArena(size_t capacity): _buffer(new unsigned char[capacity]), _capacity(capacity), _ownsBuffer(true) {}
+    StateArena(void *buffer, size_t capacity): _buffer(static_cast<unsigned char *>(buffer)), _capacity(capacity) {}
+    ~StateArena() {
+      if (_ownsBuffer) delete[] _buffer;
+    }
+
+    StateArena(StateArena const &) = delete;
+    StateArena &operator=(StateArena const &) = delete;
+
+    /**
+     * @brief Builds an object inside the arena
+     * @return A pointer to the object, or nullptr if the arena is full
+     */
+    template <class T, class ...Args>
+    T *make(Args &&...args) {
+      void *memory = allocate(sizeof(T), alignof(T));
+      if (!memory) return nullptr;
+      return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Reserves raw memory inside the arena
+     * @return A pointer to the memory, or nullptr if the arena is full
+     */
+    void *allocate(size_t size, size_t alignment) {
+      uintptr_t base = reinterpret_cast<uintptr_t>(_buffer);
+      size_t offset = ((base + _used + alignment - 1) & ~(alignment - 1)) - base;
+      if (offset + size > _capacity) return nullptr;
+      _used = offset + size;
+      return _buffer + offset;
+    }
+
+    size_t getUsed() const { return _used; }
+    size_t getCapacity() const { return _capacity; }
+
+  private:
+    unsigned char *_buffer;
+    size_t        _capacity;
+    size_t        _used = 0;
+    bool          _ownsBuffer = false;
+  };
+};
@@ -1,40 +1,211 @@
 #pragma once
+#include <atomic>
+#include <stdint.h>
 #include "./SimpleFSM.hpp"
 #include "./Concurrency/LockContext.hpp"
 
+#ifdef SIMPLE_FSM_CHECK_ACTOR_OWNER
+#include <assert.h>
+#include <thread>
+#endif
+
 namespace SimpleFSM {
-  template <class Base,
-            class StateEnum, class EventEnum, class EventPayload_t,
-            class ConcurrencyPlatform, unsigned int EVENT_QUEUE_SIZE = 0>
-  class ThreadSafeFSM : public Base {
-   private:
+  /**
+   * @brief How a ThreadSafeFSM protects itself against concurrent accesses
+   */
+  enum class ThreadSafetyMode {
+    /**
+     * Every operation is serialized behind a recursive mutex
+     */
+    MUTEX,
+    /**
+     * The FSM is owned by a single thread (its executor), and never locked.
+     * Other threads can only emit events, which are posted into the FSM mailbox (EVENT_QUEUE_SIZE must be > 0),
+     * and dispatched by the owner thread on update().
+     * start(), transit(), reset() and update() MUST only be called from the owner thread.
+     * getCurrentState() can be called from any thread.
+     * Define SIMPLE_FSM_CHECK_ACTOR_OWNER (debug builds) to assert it: the first thread calling one of those becomes the owner
+     */
+    ACTOR,
+  };
+
+  /**
+   * @brief The synchronization primitives of a ThreadSafeFSM: its mutex, its event queue,
+   * and the lock-free publication of its current state (also used by FSMBuilder)
+   * See ThreadSafeFSM for EVENT_QUEUE_SIZE and MODE
+   */
+  template <class StateEnum, class EventEnum, class EventPayload_t,
+            class ConcurrencyPlatform, unsigned int EVENT_QUEUE_SIZE = 0,
+            ThreadSafetyMode MODE = ThreadSafetyMode::MUTEX>
+  class ThreadSafety {
+    static_assert(MODE != ThreadSafetyMode::ACTOR || EVENT_QUEUE_SIZE > 0,
+                  "The actor mode needs a mailbox: EVENT_QUEUE_SIZE must be greater than 0");
+
+   public:
+    /**
+     * @brief A consistent view of the FSM state, readable from any thread without locking
+     */
+    struct StateSnapshot {
+      StateEnum state;
+      uint32_t  transitions;  // Number of transitions since construction, start() excluded (wraps around at 2^24)
+    };
+
+    ThreadSafety() {
+      _eventQueue = nullptr;
+      _mutex = nullptr;
+      if constexpr (MODE == ThreadSafetyMode::MUTEX) {
+        _mutex = _concurrencyPlatform.makeMutex();
+      }
+      if constexpr (EVENT_QUEUE_SIZE > 0) {
+        _eventQueue = _concurrencyPlatform.makeQueue(EVENT_QUEUE_SIZE, sizeof(QueuedEvent));
+      }
+    }
+
+    ~ThreadSafety() {
+      delete _eventQueue;
+      delete _mutex;
+    }
+
+    ThreadSafety(ThreadSafety const &) = delete;
+    ThreadSafety &operator=(ThreadSafety const &) = delete;
+
+    /**
+     * @brief Returns the current state along with the transition counter. Wait-free: both are packed in a single atomic word
+     */
+    StateSnapshot getStateSnapshot() const {
+      uint32_t published = _published.load(std::memory_order_acquire);
+      return {static_cast<StateEnum>(published & STATE_MASK), published >> STATE_BITS};
+    }
+
+    /**
+     * @brief Gives access to the concurrency platform, e.g. to read the platform time from states
+     */
+    ConcurrencyPlatform &getConcurrencyPlatform() { return _concurrencyPlatform; }
+
+   protected:
     struct QueuedEvent {
       EventEnum event;
       EventPayload_t payload;
     };
+
+    /**
+     * @brief Queues an event, waiting at most 1ms if the queue is full. Only valid if EVENT_QUEUE_SIZE > 0
+     */
+    FSMError _queueEvent(EventEnum event, EventPayload_t const &payload) {
+      QueuedEvent ev = {.event = event, .payload = payload};
+      if (_eventQueue->push(&ev, 1)) {
+        return FSMError::OK;
+      } else {
+        return FSMError::ASYNC_OPERATION_ERROR;
+      }
+    }
+
+    /**
+     * @brief Pops a queued event without waiting. Only valid if EVENT_QUEUE_SIZE > 0
+     */
+    bool _popEvent(QueuedEvent &ev) {
+      return _eventQueue->pop(&ev, 0);
+    }
+
+    /**
+     * @brief Publishes the state for lock-free readers. Given to the FSM as its state listener (see FSM::_setStateListener()),
+     * so that it runs under the lock, before the entry() of the new state: the thread running the FSM reads its actual state
+     * @param context The ThreadSafety instance
+     * @param state The new current state
+     * @param transition Whether to count it as a transition (start() is not one)
+     */
+    static void _publishState(void *context, StateEnum state, bool transition) {
+      auto self = static_cast<ThreadSafety *>(context);
+      uint32_t published = self->_published.load(std::memory_order_relaxed);
+      uint32_t transitions = (published >> STATE_BITS) + (transition ? 1 : 0);
+      self->_published.store(transitions << STATE_BITS | static_cast<uint32_t>(state), std::memory_order_release);
+    }
+
+    /**
+     * @brief In ACTOR mode, asserts that the caller is the owner thread. Does nothing unless SIMPLE_FSM_CHECK_ACTOR_OWNER is defined
+     */
+    void _checkOwnerThread() {
+#ifdef SIMPLE_FSM_CHECK_ACTOR_OWNER
+      if constexpr (MODE == ThreadSafetyMode::ACTOR) {
+        std::thread::id owner;
+        std::thread::id self = std::this_thread::get_id();
+        if (!_owner.compare_exchange_strong(owner, self)) {
+          assert(owner == self && "An actor FSM must only be started, transited and updated by its owner thread");
+        }
+      }
+#endif
+    }
+
+    static constexpr uint32_t STATE_BITS = 8;
+    static constexpr uint32_t STATE_MASK = (1u << STATE_BITS) - 1;
+    static_assert(static_cast<uint32_t>(StateEnum::_SIMPLE_FSM_INVALID_) <= STATE_MASK,
+                  "ThreadSafeFSM packs the state in 8 bits: at most 255 states are supported");
+
+    // Transition counter in the upper 24 bits, state in the lower 8 bits
+    std::atomic<uint32_t>                  _published{static_cast<uint32_t>(StateEnum::_SIMPLE_FSM_INVALID_)};
+#ifdef SIMPLE_FSM_CHECK_ACTOR_OWNER
+    std::atomic<std::thread::id>           _owner;
+#endif
+    ConcurrencyPlatform                    _concurrencyPlatform;
+    typename IConcurrencyPlatform::Queue  *_eventQueue;
+    typename IConcurrencyPlatform::Mutex  *_mutex;  // nullptr in ThreadSafetyMode::ACTOR
+  };
+
+  template <class Base,
+            class StateEnum, class EventEnum, class EventPayload_t,
+            class ConcurrencyPlatform, unsigned int EVENT_QUEUE_SIZE = 0,
+            ThreadSafetyMode MODE = ThreadSafetyMode::MUTEX>
+  class ThreadSafeFSM : public Base,
+                        public ThreadSafety<StateEnum, EventEnum, EventPayload_t, ConcurrencyPlatform, EVENT_QUEUE_SIZE, MODE> {
+    using Safety = ThreadSafety<StateEnum, EventEnum, EventPayload_t, ConcurrencyPlatform, EVENT_QUEUE_SIZE, MODE>;
+    using typename Safety::QueuedEvent;
+    using Safety::_mutex;
+
    public:
     using EventPayload = EventPayload_t;
-    ThreadSafeFSM() : Base() {
-      _eventQueue = nullptr;
-      _mutex = _concurrencyPlatform.makeMutex();
-      if constexpr (EVENT_QUEUE_SIZE > 0) {
-        _eventQueue = _concurrencyPlatform.makeQueue(EVENT_QUEUE_SIZE, sizeof(QueuedEvent));
-      }
+
+    /**
+     * @brief Called with the mutex held, for every event dispatched to the FSM below, along with whether its state handled it.
+     * Queued events are only reported when update() dispatches them.
+     * Lets a decorator placed above (e.g. HookableFSM) observe events as they are dispatched, rather than as they are emitted
+     */
+    using DispatchObserver = std::function<void (EventEnum event, EventPayload const &payload, bool handled)>;
+    /**
+     * @brief Called with the mutex held, after every successful transit() or reset()
+     */
+    using TransitionObserver = std::function<void (StateEnum from, StateEnum to)>;
+
+    ThreadSafeFSM() {
+      Base::_setStateListener(&Safety::_publishState, static_cast<Safety *>(this));
     }
 
     FSMError start(StateEnum initialState) {
+      Safety::_checkOwnerThread();
       LockContext lock(_mutex);
       return Base::start(initialState);
     }
 
+    FSMError reset() {
+      Safety::_checkOwnerThread();
+      LockContext lock(_mutex);
+      auto oldState = Base::getCurrentState();
+      auto result = Base::reset();
+      if (result == FSMError::OK && _transitionObserver) _transitionObserver(oldState, Base::getInitialState());
+      return result;
+    }
+
     /**
      * @brief Transitions to a next state.
       * This will be replaced by a templated method to be able to build .dot files (and will thus be deprecated soon)
       * @param newState The state to transition to
       */
     FSMError transit(StateEnum newState) {
+      Safety::_checkOwnerThread();
       LockContext lock(_mutex);
-      return Base::transit(newState);
+      auto oldState = Base::getCurrentState();
+      auto result = Base::transit(newState);
+      if (result == FSMError::OK && _transitionObserver) _transitionObserver(oldState, newState);
+      return result;
     }
 
     /**
@@ -49,15 +220,10 @@ namespace SimpleFSM {
     FSMError emit(EventEnum event, EventPayload const &payload) {
       if constexpr (EVENT_QUEUE_SIZE != 0) {
         // Only queue the event, to make it asynchronous
-        QueuedEvent ev = {.event = event, .payload = payload};
-        if (_eventQueue->push(&ev, 1)) {
-          return FSMError::OK;
-        } else {
-          return FSMError::ASYNC_OPERATION_ERROR;
-        }
+        return Safety::_queueEvent(event, payload);
       } else {
         LockContext lock(_mutex);
-        return Base::emit(event, payload);
+        return _dispatch(event, payload);
       }
     }
 
@@ -68,31 +234,57 @@ namespace SimpleFSM {
     }
 
     /**
-     * @brief Updates the FSM. Calling the loop() from the current state
+     * @brief Updates the FSM. Dispatches a batch of queued events (at most EVENT_QUEUE_SIZE), then calls the loop() from the current state
       */
     FSMError update() {
+      Safety::_checkOwnerThread();
+      LockContext lock(_mutex);
       if constexpr (EVENT_QUEUE_SIZE != 0) {
         QueuedEvent ev;
-        for (uint i = 0; i < EVENT_QUEUE_SIZE; ++i) {
-          if (!_eventQueue->pop(&ev, 0))
+        for (unsigned int i = 0; i < EVENT_QUEUE_SIZE; ++i) {
+          if (!Safety::_popEvent(ev))
             break;
-          Base::emit(ev.event, ev.payload);
+          _dispatch(ev.event, ev.payload);
         }
       }
 
-      {
-        LockContext lock(_mutex);
-        return Base::update();
-      }
+      return Base::update();
     }
 
+    /**
+     * @brief Returns the current state. Lock-free: never blocks, nor is blocked by, the thread running the FSM.
+     * The state is published as soon as it changes, before its entry() is called
+     */
     StateEnum getCurrentState() const {
-      LockContext lock(_mutex);
-      return Base::getCurrentState();
+      return Safety::getStateSnapshot().state;
+    }
+
+    /**
+     * @brief Whether the current state handles an event. Lock-free, like getCurrentState()
+     */
+    bool handlesEvent(EventEnum event) const {
+      return Base::stateHandlesEvent(getCurrentState(), event);
     }
+
+   protected:
+    /**
+     * @brief Sets the observers, replacing the previous ones. Must be called before the FSM is used concurrently.
+     * Protected, as they belong to the decorator placed above (e.g. HookableFSM)
+     */
+    void _setDispatchObserver(DispatchObserver const &observer) { _dispatchObserver = observer; }
+    void _setTransitionObserver(TransitionObserver const &observer) { _transitionObserver = observer; }
+
    private:
-    ConcurrencyPlatform                    _concurrencyPlatform;
-    typename IConcurrencyPlatform::Queue  *_eventQueue;
-    typename IConcurrencyPlatform::Mutex  *_mutex;
+    FSMError _dispatch(EventEnum event, EventPayload const &payload) {
+      if (!_dispatchObserver) return Base::emit(event, payload);
+
+      bool handled = Base::handlesEvent(event);
+      auto result = Base::emit(event, payload);
+      if (result == FSMError::OK) _dispatchObserver(event, payload, handled);
+      return result;
+    }
+
+    DispatchObserver   _dispatchObserver;
+    TransitionObserver _transitionObserver;
   };
 };  // namespace SimpleFSM